@@ -0,0 +1,210 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "macros.h"
+#include "memory_usage.h"
+
+#include "adjacency.h"
+
+using namespace std;
+
+static const int INITIAL_ROW_CAPACITY = 4;
+
+AdjacencyIndex::AdjacencyIndex() :
+    wasted(0)
+{
+}
+
+void AdjacencyIndex::clear() {
+    rows.clear();
+    entries.clear();
+    wasted = 0;
+}
+
+void AdjacencyIndex::addNode(int capacity) {
+    Row row;
+    row.offset = entries.size();
+    row.count = 0;
+    row.capacity = capacity;
+
+    rows.push_back(row);
+    entries.resize(row.offset + capacity);
+}
+
+void AdjacencyIndex::assign(const vector<uint32_t>& offsets, vector<Neighbour>& neighbours) {
+
+    rows.resize(offsets.size() - 1);
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i].offset = offsets[i];
+        rows[i].count = rows[i].capacity = offsets[i + 1] - offsets[i];
+    }
+
+    entries.swap(neighbours);
+    wasted = 0;
+}
+
+void AdjacencyIndex::addEdge(int node1, int node2, int edge) {
+    addArc(node1, node2, edge);
+    addArc(node2, node1, edge);
+}
+
+void AdjacencyIndex::removeEdge(int node1, int node2, int edge) {
+    removeArc(node1, edge);
+    removeArc(node2, edge);
+}
+
+void AdjacencyIndex::removeArc(int node, int edge) {
+
+    Row& row = rows[node];
+
+    for (int k = row.offset; k < row.offset + row.count; ++k) {
+        if (entries[k].edge != edge) continue;
+
+        entries[k] = entries[row.offset + row.count - 1];
+        row.count--;
+        return;
+    }
+}
+
+void AdjacencyIndex::renameEdge(int node1, int node2, int edge, int new_edge) {
+    renameArc(node1, edge, new_edge);
+    if (node2 != node1) renameArc(node2, edge, new_edge);
+}
+
+void AdjacencyIndex::renameArc(int node, int edge, int new_edge) {
+
+    Row& row = rows[node];
+
+    for (int k = row.offset; k < row.offset + row.count; ++k) {
+        if (entries[k].edge == edge) entries[k].edge = new_edge;
+    }
+}
+
+void AdjacencyIndex::renameNeighbour(int node, int neighbour, int new_neighbour) {
+
+    Row& row = rows[node];
+
+    for (int k = row.offset; k < row.offset + row.count; ++k) {
+        if (entries[k].node == neighbour) entries[k].node = new_neighbour;
+    }
+}
+
+void AdjacencyIndex::removeNode(int node) {
+
+    int last = rows.size() - 1;
+
+    // The neighbours of the moved node now refer to it by its new index
+    if (node != last) {
+        for (const_iterator n = begin(last); n != end(last); ++n)
+            renameNeighbour(n->node, last, node);
+    }
+
+    removeRow(node);
+}
+
+void AdjacencyIndex::removeRow(int node) {
+
+    int last = rows.size() - 1;
+
+    wasted += rows[node].capacity;
+
+    if (node != last) rows[node] = rows[last];
+
+    rows.pop_back();
+}
+
+void AdjacencyIndex::addArc(int node, int neighbour, int edge) {
+
+    if (rows[node].count == rows[node].capacity) {
+
+        Row& row = rows[node];
+        int capacity = MAX(INITIAL_ROW_CAPACITY, 2 * row.capacity);
+
+        if (row.offset + row.capacity == (int) entries.size()) {
+            // last row of the array: simply grow it
+            entries.resize(row.offset + capacity);
+        }
+        else {
+            int offset = entries.size();
+            entries.resize(offset + capacity);
+            copy(entries.begin() + row.offset,
+                 entries.begin() + row.offset + row.count,
+                 entries.begin() + offset);
+
+            wasted += row.capacity;
+            row.offset = offset;
+        }
+
+        row.capacity = capacity;
+
+        if (wasted > (int) entries.size() / 2) compact();
+    }
+
+    Row& row = rows[node];
+
+    Neighbour& n = entries[row.offset + row.count];
+    n.node = neighbour;
+    n.edge = edge;
+
+    row.count++;
+}
+
+void AdjacencyIndex::shrink() {
+    if (wasted > (int) entries.size() / 4) compact();
+}
+
+void AdjacencyIndex::compact() {
+
+    vector<Neighbour> compacted;
+    compacted.reserve(entries.size() - wasted);
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        Row& row = rows[i];
+
+        int offset = compacted.size();
+        compacted.insert(compacted.end(),
+                         entries.begin() + row.offset,
+                         entries.begin() + row.offset + row.capacity);
+        row.offset = offset;
+    }
+
+    entries.swap(compacted);
+    wasted = 0;
+}
+
+AdjacencyIndex::const_iterator AdjacencyIndex::begin(int node) const {
+    if (entries.empty()) return NULL;
+    return &entries[0] + rows[node].offset;
+}
+
+AdjacencyIndex::const_iterator AdjacencyIndex::end(int node) const {
+    if (entries.empty()) return NULL;
+    return &entries[0] + rows[node].offset + rows[node].count;
+}
+
+int AdjacencyIndex::degree(int node) const {
+    return rows[node].count;
+}
+
+int AdjacencyIndex::nodesCount() const {
+    return rows.size();
+}
+
+size_t AdjacencyIndex::memoryUsage() const {
+    return capacityBytes(rows) + capacityBytes(entries);
+}
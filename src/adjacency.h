@@ -0,0 +1,151 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ADJACENCY_H
+#define ADJACENCY_H
+
+#include <vector>
+#include <stdint.h>
+
+/**
+  Adjacency of the graph's nodes, stored in compressed sparse row (CSR)
+  format: the neighbours of every node are stored contiguously in one
+  single array.
+
+  Nodes and edges are identified by their integer index (cf Node::index and
+  Graph::edges).
+
+  To support incremental insertion, each row has some spare capacity. When a
+  row is full, it is moved to the end of the array with twice its capacity.
+  The array is compacted when too much space is lost this way. Adding an
+  edge is therefore amortized O(1).
+  */
+class AdjacencyIndex
+{
+public:
+    struct Neighbour {
+        int node; // index of the node at the other end of the edge
+        int edge; // index of the edge
+    };
+
+    typedef const Neighbour* const_iterator;
+
+    AdjacencyIndex();
+
+    /**
+      Appends a new node (with no neighbour yet). Its index is the current
+      amount of nodes. Its row is created with room for 'capacity'
+      neighbours, eg when its degree is known in advance.
+      */
+    void addNode(int capacity = 0);
+
+    /**
+      Replaces the whole index with the rows of offsets.size() - 1 nodes, eg
+      when a snapshot is loaded (cf SnapshotFile::buildRows()): the
+      neighbours of node i are neighbours[offsets[i]] to
+      neighbours[offsets[i + 1]] (excluded). The neighbours are taken over
+      (swapped with the former ones). Rows are created full: the first
+      neighbour added to a row moves it.
+      */
+    void assign(const std::vector<uint32_t>& offsets, std::vector<Neighbour>& neighbours);
+
+    /**
+      Registers an (undirected) edge between node1 and node2.
+      */
+    void addEdge(int node1, int node2, int edge);
+
+    /**
+      Unregisters the edge between node1 and node2. The last neighbour of
+      each node takes the place of the removed one.
+      */
+    void removeEdge(int node1, int node2, int edge);
+
+    /**
+      The edge between node1 and node2 is now identified by 'new_edge'.
+      */
+    void renameEdge(int node1, int node2, int edge, int new_edge);
+
+    /**
+      Removes a node, once all its edges have been removed. The last node
+      takes its index.
+      */
+    void removeNode(int node);
+
+    /**
+      Directed use (cf RelationTable): registers 'edge' in the row of 'node'
+      only, leading to 'neighbour'.
+      */
+    void addArc(int node, int neighbour, int edge);
+
+    /**
+      Unregisters 'edge' from the row of 'node' only. The last neighbour of
+      the row takes the place of the removed one.
+      */
+    void removeArc(int node, int edge);
+
+    /**
+      In the row of 'node' only, 'edge' is now identified by 'new_edge'.
+      */
+    void renameArc(int node, int edge, int new_edge);
+
+    /**
+      In the row of 'node', 'neighbour' is now referred to as 'new_neighbour'.
+      */
+    void renameNeighbour(int node, int neighbour, int new_neighbour);
+
+    /**
+      Removes the row of 'node', once empty. The last row takes its place,
+      but the other rows still refer to the last node by its former index
+      (cf renameNeighbour).
+      */
+    void removeRow(int node);
+
+    const_iterator begin(int node) const;
+    const_iterator end(int node) const;
+    int degree(int node) const;
+
+    int nodesCount() const;
+
+    void clear();
+
+    size_t memoryUsage() const;
+
+    /**
+      Compacts the array if more than a quarter of it is lost to moved rows,
+      so that rows are stored contiguously again, in the order of the nodes.
+      Meant to be called after many edges have been added (cf
+      Graph::commit()).
+      */
+    void shrink();
+
+private:
+    struct Row {
+        int offset;
+        int count;
+        int capacity;
+    };
+
+    std::vector<Row> rows;
+    std::vector<Neighbour> entries;
+
+    // Amount of entries left unused after rows have been moved.
+    int wasted;
+
+    void compact();
+};
+
+#endif // ADJACENCY_H
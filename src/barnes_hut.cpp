@@ -0,0 +1,223 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include "macros.h"
+#include "constants.h"
+#include "memory_usage.h"
+
+#include "coulomb.h"
+#include "barnes_hut.h"
+
+using namespace std;
+
+// Past this depth, cells are not subdivided anymore: nodes are simply
+// accumulated in the leaf. Prevents infinite subdivision when two nodes share
+// the exact same position.
+static const int MAX_TREE_DEPTH = 24;
+
+BarnesHutTree::BarnesHutTree() :
+    theta(DEFAULT_BARNES_HUT_THETA),
+    coulomb_constant(DEFAULT_COULOMB_CONSTANT)
+{
+}
+
+void BarnesHutTree::setTheta(float theta) {
+    this->theta = theta;
+}
+
+int BarnesHutTree::size() const {
+    return bodies.size();
+}
+
+size_t BarnesHutTree::memoryUsage() const {
+    return capacityBytes(cells) + capacityBytes(bodies);
+}
+
+int BarnesHutTree::newCell(const vec2f& centre, float half_size, int depth) {
+    Cell cell;
+    cell.centre = centre;
+    cell.half_size = half_size;
+    cell.centre_of_charge = centre;
+    cell.charge = 0.0;
+    cell.first_child = -1;
+    cell.first_body = -1;
+    cell.depth = depth;
+
+    cells.push_back(cell);
+    return cells.size() - 1;
+}
+
+void BarnesHutTree::reset(const vec2f& min, const vec2f& max, float coulomb_constant) {
+    cells.clear();
+    bodies.clear();
+
+    this->coulomb_constant = coulomb_constant;
+
+    // The root cell is a square, with a small margin to make sure the nodes
+    // lying exactly on the bounds are inside.
+    float half_size = MAX(max.x - min.x, max.y - min.y) * 0.5 + 1.0;
+
+    newCell((min + max) * 0.5, half_size, 0);
+}
+
+int BarnesHutTree::childFor(const Cell& cell, const vec2f& pos) const {
+    return cell.first_child
+            + (pos.x >= cell.centre.x ? 1 : 0)
+            + (pos.y >= cell.centre.y ? 2 : 0);
+}
+
+void BarnesHutTree::subdivide(int c) {
+
+    // Careful: newCell() may reallocate 'cells'. No reference on a cell
+    // must be held across these calls.
+    vec2f centre = cells[c].centre;
+    float quarter = cells[c].half_size * 0.5;
+    int depth = cells[c].depth + 1;
+
+    int first = newCell(centre + vec2f(-quarter, -quarter), quarter, depth);
+    newCell(centre + vec2f(quarter, -quarter), quarter, depth);
+    newCell(centre + vec2f(-quarter, quarter), quarter, depth);
+    newCell(centre + vec2f(quarter, quarter), quarter, depth);
+
+    cells[c].first_child = first;
+
+    //Move the bodies of the former leaf to the new children
+    int b = cells[c].first_body;
+    cells[c].first_body = -1;
+
+    while (b != -1) {
+        int next = bodies[b].next;
+        int child = childFor(cells[c], bodies[b].pos);
+
+        bodies[b].next = cells[child].first_body;
+        cells[child].first_body = b;
+
+        b = next;
+    }
+}
+
+void BarnesHutTree::insert(int index, const vec2f& pos, float charge) {
+
+    Body body;
+    body.index = index;
+    body.pos = pos;
+    body.charge = charge;
+    body.next = -1;
+
+    int b = bodies.size();
+    bodies.push_back(body);
+
+    int c = 0;
+
+    while(true) {
+        if (cells[c].first_child != -1) { //inner cell: go down
+            c = childFor(cells[c], body.pos);
+            continue;
+        }
+
+        if (cells[c].first_body == -1 || cells[c].depth >= MAX_TREE_DEPTH) {
+            bodies[b].next = cells[c].first_body;
+            cells[c].first_body = b;
+            return;
+        }
+
+        //leaf already occupied: split it, and try again
+        subdivide(c);
+    }
+}
+
+void BarnesHutTree::computeCharges() {
+
+    // Children are always created after their parent: walking the cells
+    // backward ensures children are aggregated before their parent.
+    for (int c = cells.size() - 1; c >= 0; --c) {
+        Cell& cell = cells[c];
+
+        float charge = 0.0;
+        vec2f weighted_pos(0.0, 0.0);
+
+        if (cell.first_child == -1) {
+            for (int b = cell.first_body; b != -1; b = bodies[b].next) {
+                charge += bodies[b].charge;
+                weighted_pos += bodies[b].pos * bodies[b].charge;
+            }
+        }
+        else {
+            for (int i = 0; i < 4; ++i) {
+                const Cell& child = cells[cell.first_child + i];
+                charge += child.charge;
+                weighted_pos += child.centre_of_charge * child.charge;
+            }
+        }
+
+        cell.charge = charge;
+        if (charge > 0.0)
+            cell.centre_of_charge = weighted_pos / charge;
+    }
+}
+
+vec2f BarnesHutTree::repulsionAt(const vec2f& pos, float charge, int exclude) const {
+    return repulsionAt(pos, charge, exclude, theta);
+}
+
+vec2f BarnesHutTree::repulsionAt(const vec2f& pos, float charge, int exclude, float theta) const {
+
+    vec2f force(0.0, 0.0);
+
+    if (cells.empty()) return force;
+
+    float theta2 = theta * theta;
+
+    // Explicit stack: depth-first traversal pushes at most 4 cells per level.
+    int stack[4 * (MAX_TREE_DEPTH + 1)];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Cell& cell = cells[stack[--top]];
+
+        if (cell.charge == 0.0) continue;
+
+        if (cell.first_child == -1) {
+            for (int b = cell.first_body; b != -1; b = bodies[b].next) {
+                if (bodies[b].index == exclude) continue;
+                force += coulomb(bodies[b].pos - pos, bodies[b].charge * charge);
+            }
+            continue;
+        }
+
+        vec2f delta = cell.centre_of_charge - pos;
+        float size = 2 * cell.half_size;
+
+        // A cell that contains the point is never approximated: the point
+        // would otherwise be repulsed by its own charge.
+        bool contains = fabs(pos.x - cell.centre.x) <= cell.half_size &&
+                        fabs(pos.y - cell.centre.y) <= cell.half_size;
+
+        if (!contains && size * size < theta2 * delta.length2()) {
+            force += coulomb(delta, cell.charge * charge);
+            continue;
+        }
+
+        for (int i = 0; i < 4; ++i)
+            stack[top++] = cell.first_child + i;
+    }
+
+    return force * coulomb_constant;
+}
@@ -0,0 +1,112 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include <vector>
+
+#include "core/vectors.h"
+
+/**
+  Quadtree used to approximate the Coulomb repulsion between nodes
+  (Barnes-Hut algorithm).
+
+  Each cell of the tree stores the total charge and the centre of charge
+  of the nodes it contains. When a cell is far enough from the point where
+  the repulsion is evaluated (ie, cell size / distance < theta), the whole
+  cell is considered as a single charge. This reduces the cost of the
+  repulsion for one node from O(N) to O(log N).
+
+  The tree is meant to be rebuilt from scratch at each physics step:
+  reset(), then insert() every node, then computeCharges().
+  */
+class BarnesHutTree
+{
+    struct Cell {
+        vec2f centre; // geometric centre of the cell
+        float half_size;
+
+        vec2f centre_of_charge;
+        float charge;
+
+        int first_child; // index of the first of the 4 children. -1 for leaves.
+        int first_body; // leaves only: head of the list of bodies. -1 if empty.
+        int depth;
+    };
+
+    struct Body {
+        int index; // index of the node in the graph (cf Node::index)
+        vec2f pos;
+        float charge;
+        int next; // next body in the same leaf, -1 if none.
+    };
+
+    std::vector<Cell> cells;
+    std::vector<Body> bodies;
+
+    float theta;
+    float coulomb_constant;
+
+    int newCell(const vec2f& centre, float half_size, int depth);
+    void subdivide(int cell);
+    int childFor(const Cell& cell, const vec2f& pos) const;
+
+public:
+    BarnesHutTree();
+
+    /**
+      Empties the tree and sets the area it covers, and the Coulomb constant
+      of the repulsion. Nodes inserted afterwards must lie within [min, max].
+      */
+    void reset(const vec2f& min, const vec2f& max, float coulomb_constant);
+
+    void insert(int index, const vec2f& pos, float charge);
+
+    /**
+      Aggregates the charge and centre of charge of every cell. Must be called
+      once all nodes have been inserted, and before any repulsion query.
+      */
+    void computeCharges();
+
+    /**
+      Sets the opening angle. 0 means no approximation at all (equivalent to
+      the exact O(N^2) computation), larger values are faster but less
+      accurate. Usual values are between 0.5 and 1.0.
+      */
+    void setTheta(float theta);
+
+    /**
+      Returns the Coulomb repulsion applied by the nodes of the tree on a
+      charge located at pos. If 'exclude' is a valid node index, this node is
+      not taken into account (typically, the node we are computing the
+      repulsion for).
+      */
+    vec2f repulsionAt(const vec2f& pos, float charge, int exclude = -1) const;
+
+    /**
+      Same as above, with a specific opening angle instead of the one of the
+      tree (for instance, a larger one for a coarser approximation).
+      */
+    vec2f repulsionAt(const vec2f& pos, float charge, int exclude, float theta) const;
+
+    int size() const;
+
+    size_t memoryUsage() const;
+};
+
+#endif // BARNES_HUT_H
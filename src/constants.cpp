@@ -1,7 +1,123 @@
+#include <iostream>
+
+#include <json/json.h>
+
 #include "constants.h"
 
+using namespace std;
+
 // Default initialization of physics constants
 float INITIAL_MASS(DEFAULT_INITIAL_MASS);
 float INITIAL_DAMPING(DEFAULT_INITIAL_DAMPING);
 float COULOMB_CONSTANT(DEFAULT_COULOMB_CONSTANT);
 float MAX_SPEED(DEFAULT_MAX_SPEED);
+repulsion_engine REPULSION_ENGINE(DEFAULT_REPULSION_ENGINE);
+float BARNES_HUT_THETA(DEFAULT_BARNES_HUT_THETA);
+float GRID_CUTOFF(DEFAULT_GRID_CUTOFF);
+int PHYSICS_THREADS(DEFAULT_PHYSICS_THREADS);
+bool USE_SIMD(DEFAULT_USE_SIMD);
+float PHYSICS_TICK_RATE(DEFAULT_PHYSICS_TICK_RATE);
+bool MULTILEVEL_LAYOUT(DEFAULT_MULTILEVEL_LAYOUT);
+float SLEEP_DELAY(DEFAULT_SLEEP_DELAY);
+float SLEEP_ENERGY(DEFAULT_SLEEP_ENERGY);
+float REST_ENERGY(DEFAULT_REST_ENERGY);
+float REST_DISPLACEMENT(DEFAULT_REST_DISPLACEMENT);
+float REST_DELAY(DEFAULT_REST_DELAY);
+unsigned int RANDOM_SEED(DEFAULT_RANDOM_SEED);
+int FOCUS_RADIUS(DEFAULT_FOCUS_RADIUS);
+int LOD_DECIMATION(DEFAULT_LOD_DECIMATION);
+float LOD_THETA(DEFAULT_LOD_THETA);
+layout_solver LAYOUT_SOLVER(DEFAULT_LAYOUT_SOLVER);
+int STRESS_PIVOTS(DEFAULT_STRESS_PIVOTS);
+float STRESS_TOLERANCE(DEFAULT_STRESS_TOLERANCE);
+int NODE_BUDGET(DEFAULT_NODE_BUDGET);
+
+void physicsSetup(const Json::Value& config) {
+
+    Json::Value physics = config["physics"];
+
+    if (physics == Json::nullValue) return; // Uses defaults, as specified in constants.h
+
+    cout << "Setting customs physics parameters from config file." << endl;
+    if (physics["mass"] != Json::nullValue) {
+        INITIAL_MASS = physics["mass"].asDouble();
+    }
+    if (physics["damping"] != Json::nullValue) {
+        INITIAL_DAMPING = physics["damping"].asDouble();
+    }
+    if (physics["repulsion"] != Json::nullValue) {
+        COULOMB_CONSTANT = physics["repulsion"].asDouble();
+    }
+    if (physics["maxspeed"] != Json::nullValue) {
+        MAX_SPEED = physics["maxspeed"].asDouble();
+    }
+    if (physics["engine"] != Json::nullValue) {
+        string engine = physics["engine"].asString();
+
+        if (engine == "exact") REPULSION_ENGINE = EXACT_ENGINE;
+        else if (engine == "barnes-hut") REPULSION_ENGINE = BARNES_HUT_ENGINE;
+        else if (engine == "grid") REPULSION_ENGINE = GRID_ENGINE;
+        else cerr << "Unknown physics engine '" << engine << "'. Using default one." << endl;
+    }
+    if (physics["theta"] != Json::nullValue) {
+        BARNES_HUT_THETA = physics["theta"].asDouble();
+    }
+    if (physics["cutoff"] != Json::nullValue) {
+        GRID_CUTOFF = physics["cutoff"].asDouble();
+    }
+    if (physics["threads"] != Json::nullValue) {
+        PHYSICS_THREADS = physics["threads"].asInt();
+    }
+    if (physics["simd"] != Json::nullValue) {
+        USE_SIMD = physics["simd"].asBool();
+    }
+    if (physics["multilevel_layout"] != Json::nullValue) {
+        MULTILEVEL_LAYOUT = physics["multilevel_layout"].asBool();
+    }
+    if (physics["tick_rate"] != Json::nullValue) {
+        PHYSICS_TICK_RATE = physics["tick_rate"].asDouble();
+    }
+    if (physics["sleep_delay"] != Json::nullValue) {
+        SLEEP_DELAY = physics["sleep_delay"].asDouble();
+    }
+    if (physics["sleep_energy"] != Json::nullValue) {
+        SLEEP_ENERGY = physics["sleep_energy"].asDouble();
+    }
+    if (physics["rest_energy"] != Json::nullValue) {
+        REST_ENERGY = physics["rest_energy"].asDouble();
+    }
+    if (physics["rest_displacement"] != Json::nullValue) {
+        REST_DISPLACEMENT = physics["rest_displacement"].asDouble();
+    }
+    if (physics["rest_delay"] != Json::nullValue) {
+        REST_DELAY = physics["rest_delay"].asDouble();
+    }
+    if (physics["seed"] != Json::nullValue) {
+        RANDOM_SEED = physics["seed"].asUInt();
+    }
+    if (physics["focus_radius"] != Json::nullValue) {
+        FOCUS_RADIUS = physics["focus_radius"].asInt();
+    }
+    if (physics["lod_decimation"] != Json::nullValue) {
+        LOD_DECIMATION = physics["lod_decimation"].asInt();
+    }
+    if (physics["lod_theta"] != Json::nullValue) {
+        LOD_THETA = physics["lod_theta"].asDouble();
+    }
+    if (physics["solver"] != Json::nullValue) {
+        string solver = physics["solver"].asString();
+
+        if (solver == "forces") LAYOUT_SOLVER = FORCE_SOLVER;
+        else if (solver == "stress") LAYOUT_SOLVER = STRESS_SOLVER;
+        else cerr << "Unknown layout solver '" << solver << "'. Using default one." << endl;
+    }
+    if (physics["stress_pivots"] != Json::nullValue) {
+        STRESS_PIVOTS = physics["stress_pivots"].asInt();
+    }
+    if (physics["stress_tolerance"] != Json::nullValue) {
+        STRESS_TOLERANCE = physics["stress_tolerance"].asDouble();
+    }
+    if (physics["node_budget"] != Json::nullValue) {
+        NODE_BUDGET = physics["node_budget"].asInt();
+    }
+}
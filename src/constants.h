@@ -21,11 +21,21 @@
 #include <string>
 #include "core/vectors.h"
 
+namespace Json {
+    class Value;
+}
+
 enum node_type {CLASS_NODE, INSTANCE_NODE, LITERAL_NODE, COMMENT_NODE, TRUE_NODE, FALSE_NODE};
 
 //note that PROPERTY is either OBJ_PROPERTY or DATA_PROPERTY or COMMENT
 enum relation_type {SUBCLASS, SUPERCLASS, INSTANCE, CLASS, PROPERTY, OBJ_PROPERTY, DATA_PROPERTY, COMMENT, UNDEFINED};
 
+//how the repulsion between nodes is computed
+enum repulsion_engine {EXACT_ENGINE, BARNES_HUT_ENGINE, GRID_ENGINE};
+
+//how the layout is computed: spring-electrical forces, or stress majorization
+enum layout_solver {FORCE_SOLVER, STRESS_SOLVER};
+
 static const std::string dateFormat("%A, %d %B, %Y %X");
 
 static const float GRAVITY = 9.81;
@@ -44,14 +54,73 @@ static const float NOMINAL_EDGE_LENGTH = 50.0; // pixels
 static const float MIN_KINETIC_ENERGY = 1.0; //Nodes with a lower energy won't move at all.
 static const float DEFAULT_MAX_SPEED = 500.0; //Maximum allowed speed for a node.
 
+static const repulsion_engine DEFAULT_REPULSION_ENGINE = BARNES_HUT_ENGINE;
+static const float DEFAULT_BARNES_HUT_THETA = 0.8; // Barnes-Hut opening angle. 0 means exact computation.
+static const float DEFAULT_GRID_CUTOFF = 200.0; // With the grid engine, nodes further than that (in pixels) do not repulse each other.
+
+static const int DEFAULT_PHYSICS_THREADS = 0; // Threads used by the physics step. 0 means one per core.
+static const bool DEFAULT_USE_SIMD = true; // If false, the physics always uses scalar kernels.
+
+static const bool DEFAULT_MULTILEVEL_LAYOUT = true; // If true, the graph loaded at startup is placed with a multilevel layout.
+
+static const float DEFAULT_PHYSICS_TICK_RATE = 60.0; // Physics steps per second, independently of the rendering framerate.
+
+static const float DEFAULT_SLEEP_DELAY = 1.0; // Time (in sec) a node must stay calm before falling asleep. 0 disables sleeping.
+static const float DEFAULT_SLEEP_ENERGY = 2.0; // Nodes with a lower kinetic energy are considered as calm.
+
+static const float DEFAULT_REST_ENERGY = 1.0; // Average kinetic energy per node below which the graph may be at rest.
+static const float DEFAULT_REST_DISPLACEMENT = 0.1; // Maximum displacement of a node in one step (in pixels) below which the graph may be at rest.
+static const float DEFAULT_REST_DELAY = 2.0; // Time (in sec) the graph must stay under both thresholds before the simulation is suspended. 0 disables it.
+
+static const int DEFAULT_FOCUS_RADIUS = 6; // When nodes are selected, nodes closer than that (in edges) are simulated at full rate. Matches MAX_NODE_LEVELS. 0 disables the level of detail.
+static const int DEFAULT_LOD_DECIMATION = 4; // Nodes out of focus are only simulated every LOD_DECIMATION ticks. 0 freezes them.
+static const float DEFAULT_LOD_THETA = 1.5; // Barnes-Hut opening angle used for the repulsion of nodes out of focus.
+
+static const layout_solver DEFAULT_LAYOUT_SOLVER = FORCE_SOLVER;
+static const int DEFAULT_STRESS_PIVOTS = 50; // Pivots of the sparse stress model. More pivots give a more accurate layout, but slower iterations.
+static const float DEFAULT_STRESS_TOLERANCE = 1e-4; // With the stress solver, the layout may be at rest once an iteration lowers the stress by less than that (relative decrease), or moves no node by more than REST_DISPLACEMENT.
+
+static const int DEFAULT_NODE_BUDGET = 0; // Maximum amount of nodes. Beyond, the least recently used nodes, out of focus first, are removed. 0 means no limit.
+
+static const unsigned int DEFAULT_RANDOM_SEED = 0; // Seed of the random generator of the graph. 0 means a different seed at each run.
+
 static const std::string ROOT_CONCEPT = "owl:Thing";
 
+static const int DEFAULT_INGESTION_THREADS = 2; // Threads fetching resources from the ontology in the background, ie requests in flight.
+static const float DEFAULT_INGESTION_BUDGET = 4.0; // Time (in ms) the main loop may spend per frame adding fetched resources to the graph.
+
 
 /********** Those values can be set in the config file *************/
 extern float INITIAL_MASS;
 extern float INITIAL_DAMPING;
 extern float COULOMB_CONSTANT;
 extern float MAX_SPEED;
+extern repulsion_engine REPULSION_ENGINE;
+extern float BARNES_HUT_THETA;
+extern float GRID_CUTOFF;
+extern int PHYSICS_THREADS;
+extern bool USE_SIMD;
+extern float PHYSICS_TICK_RATE;
+extern bool MULTILEVEL_LAYOUT;
+extern float SLEEP_DELAY;
+extern float SLEEP_ENERGY;
+extern float REST_ENERGY;
+extern float REST_DISPLACEMENT;
+extern float REST_DELAY;
+extern unsigned int RANDOM_SEED;
+extern int FOCUS_RADIUS;
+extern int LOD_DECIMATION;
+extern float LOD_THETA;
+extern layout_solver LAYOUT_SOLVER;
+extern int STRESS_PIVOTS;
+extern float STRESS_TOLERANCE;
+extern int NODE_BUDGET;
+
+/**
+  Sets the values above from the "physics" section of the configuration.
+  Missing keys keep their default value.
+  */
+void physicsSetup(const Json::Value& config);
 
 #endif // CONSTANTS_H
 
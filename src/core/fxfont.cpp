@@ -31,10 +31,12 @@ FXFontManager fontmanager;
 
 FXFont::FXFont() {
     ft = 0;
+    glyphs = 0;
 }
 
-FXFont::FXFont(FTFont* ft) {
+FXFont::FXFont(FTFont* ft, FXGlyphCache* glyphs) {
     this->ft = ft;
+    this->glyphs = glyphs;
     init();
 }
 
@@ -77,6 +79,9 @@ void FXFont::dropShadow(bool shadow) {
 }
 
 int FXFont::setFontSize(int pt) {
+    // FTGL drops its glyph cache whenever the face size is set
+    if(glyphs) glyphs->clear();
+
     return ft->FaceSize(pt);
 }
 
@@ -109,6 +114,8 @@ void FXFont::render(float x, float y, const std::string& text) {
         glScalef(1.0, -1.0, 1.0f);
         ft->Render(text.c_str());
     glPopMatrix();
+
+    if(glyphs) glyphs->add(text);
 }
 
 void FXFont::print(float x, float y, const char *str, ...) {
@@ -146,6 +153,42 @@ void FXFont::draw(float x, float y, const std::string& text) {
     render(x, y, text);
 }
 
+// FXGlyphCache
+
+void FXGlyphCache::clear() {
+    ascii.reset();
+    others.clear();
+}
+
+void FXGlyphCache::add(const std::string& text) {
+
+    for(size_t i = 0; i < text.size();) {
+        unsigned int c = (unsigned char) text[i++];
+
+        if(c < 128) {
+            ascii.set(c);
+            continue;
+        }
+
+        // the whole UTF-8 sequence identifies the glyph
+        while(i < text.size() && (text[i] & 0xC0) == 0x80) {
+            c = (c << 8) | (unsigned char) text[i++];
+        }
+
+        others.insert(c);
+    }
+}
+
+int FXGlyphCache::size() const {
+    return ascii.count() + others.size();
+}
+
+size_t FXGlyphCache::memoryUsage(FTFont* ft) const {
+    size_t cell = (size_t) (ft->FaceSize() * ft->LineHeight());
+
+    return size() * cell;
+}
+
 // FXFontManager
 
 void FXFontManager::setDir(std::string font_dir) {
@@ -159,6 +202,33 @@ void FXFontManager::purge() {
     }
 
     fonts.clear();
+    glyphs.clear();
+}
+
+int FXFontManager::fontsCount() const {
+    return fonts.size();
+}
+
+int FXFontManager::glyphsCount() const {
+    int count = 0;
+
+    for(std::map<std::string, FXGlyphCache>::const_iterator it= glyphs.begin(); it!=glyphs.end();it++) {
+        count += it->second.size();
+    }
+
+    return count;
+}
+
+size_t FXFontManager::memoryUsage() const {
+    size_t bytes = 0;
+
+    for(std::map<std::string, FTFont*>::const_iterator it= fonts.begin(); it!=fonts.end();it++) {
+        std::map<std::string, FXGlyphCache>::const_iterator cache = glyphs.find(it->first);
+
+        if(cache != glyphs.end()) bytes += cache->second.memoryUsage(it->second);
+    }
+
+    return bytes;
 }
 
 FXFont FXFontManager::grab(std::string font_file, int size) {
@@ -181,7 +251,7 @@ FXFont FXFontManager::grab(std::string font_file, int size) {
         fonts[font_key] = ft;
     }
 
-    return FXFont(ft);
+    return FXFont(ft, &glyphs[font_key]);
 }
 
 FTFont* FXFontManager::create(std::string font_file, int size) {
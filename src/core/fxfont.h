@@ -36,6 +36,8 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <bitset>
 
 #include <FTGL/ftgl.h>
 
@@ -44,9 +46,24 @@ public:
     FXFontException(std::string& font_file) : ResourceException(font_file) {}
 };
 
+// Glyphs a font has rendered since its face size was last set, ie what its
+// FTGL glyph cache holds (FTGL does not tell). Used for memory accounting.
+class FXGlyphCache {
+    std::bitset<128> ascii;
+    std::set<unsigned int> others;
+public:
+    void clear();
+    void add(const std::string& text);
+    int size() const;
+
+    // estimate: one texel (GL_ALPHA) per pixel of each glyph cell
+    size_t memoryUsage(FTFont* ft) const;
+};
+
 class FXFont {
 
     FTFont* ft;
+    FXGlyphCache* glyphs;
 
     bool shadow;
     bool round;
@@ -60,7 +77,7 @@ class FXFont {
     void init();
 public:
     FXFont();
-    FXFont(FTFont* ft);
+    FXFont(FTFont* ft, FXGlyphCache* glyphs = 0);
 
     FTFont* getFTFont();
 
@@ -89,12 +106,17 @@ class FXFontManager {
     std::string font_dir;
 
     std::map<std::string, FTFont*> fonts;
+    std::map<std::string, FXGlyphCache> glyphs;
 
     FTFont* create(std::string font_file, int size);
 public:
     void setDir(std::string font_dir);
     void purge();
     FXFont grab(std::string font_file, int size);
+
+    int fontsCount() const;
+    int glyphsCount() const;
+    size_t memoryUsage() const;
 };
 
 extern FXFontManager fontmanager;
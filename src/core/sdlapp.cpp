@@ -206,6 +206,7 @@ SDLApp::SDLApp() {
     fps=0;
     return_code=0;
     appFinished=false;
+    redraw=true;
 }
 
 void SDLApp::updateFramerate() {
@@ -309,8 +310,8 @@ int SDLApp::run() {
         update(t, dt);
 
 #ifndef TEXT_ONLY
-        //update display
-        display.update();
+        //update display, unless nothing was drawn
+        if(redraw) display.update();
 #endif
         frame_count++;
     }
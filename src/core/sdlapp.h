@@ -76,6 +76,7 @@ class SDLApp {
 protected:
     float fps;
     bool appFinished;
+    bool redraw; //if false, the display is not refreshed after update()
     void stop(int return_code);
 public:
     SDLApp();
@@ -49,6 +49,26 @@ TextureResource* TextureManager::grab(std::string name, int mipmaps, int clamp,
     return (TextureResource*)r;
 }
 
+int TextureManager::texturesCount() const {
+    int count = 0;
+
+    for(std::map<std::string, Resource*>::const_iterator it= resources.begin(); it!=resources.end();it++) {
+        if(it->second != 0) count++;
+    }
+
+    return count;
+}
+
+size_t TextureManager::memoryUsage() const {
+    size_t total = 0;
+
+    for(std::map<std::string, Resource*>::const_iterator it= resources.begin(); it!=resources.end();it++) {
+        if(it->second != 0) total += ((TextureResource*)it->second)->bytes;
+    }
+
+    return total;
+}
+
 // texture resource
 
 TextureResource::TextureResource(std::string file, int mipmaps, int clamp, int trilinear, bool external_file) : Resource(file) {
@@ -73,6 +93,10 @@ TextureResource::TextureResource(std::string file, int mipmaps, int clamp, int t
     if(format==0) throw TextureException(file);
 
     textureid = display.createTexture(w, h, mipmaps, clamp, trilinear, format, (unsigned int*) surface->pixels);
+
+    // textures are stored as RGBA. Mipmaps add a third.
+    bytes = (size_t) w * h * 4;
+    if(mipmaps) bytes += bytes / 3;
 }
 
 int TextureResource::colourFormat(SDL_Surface* surface) {
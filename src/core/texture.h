@@ -44,6 +44,7 @@ class TextureResource : public Resource {
 public:
 	int w, h;
     GLuint textureid;
+    size_t bytes; // estimated video memory, mipmaps included
     TextureResource(std::string name, int mipmaps, int clamp, int trilinear, bool external_file);
     ~TextureResource();
 };
@@ -52,6 +53,9 @@ class TextureManager : public ResourceManager {
 public:
     TextureManager();
     TextureResource* grab(std::string file, int mipmaps=1, int clamp=1, int trilinear=0, bool external_file = false);
+
+    int texturesCount() const;
+    size_t memoryUsage() const;
 };
 
 extern TextureManager texturemanager;
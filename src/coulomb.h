@@ -0,0 +1,45 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COULOMB_H
+#define COULOMB_H
+
+#include <cmath>
+
+#include "core/vectors.h"
+
+#include "macros.h"
+
+/** Coulomb repulsion between two charges (whose product is 'charges'),
+  separated by 'delta' (vector from the point where the force applies to the
+  source of the repulsion), for a unit Coulomb constant: sums of repulsions
+  are scaled by the actual constant once, at the end.
+
+  Same convention as the physics kernels: coincident charges are ignored.
+  */
+inline vec2f coulomb(const vec2f& delta, float charges) {
+
+    float len = delta.length2();
+
+    if (len == 0.0) return vec2f(0.0, 0.0);
+
+    float f = charges / MAX(len, 0.01);
+
+    return delta * (- f / sqrt(len));
+}
+
+#endif // COULOMB_H
@@ -33,12 +33,21 @@
 using namespace std;
 using namespace boost;
 
-Edge::Edge(const NodeRelation& rel, const string& label) :
-    node1(rel.from),
-    node2(rel.to),
-    rel_type(rel.type),
+/** Tag of an edge, from the tags of its nodes: their IDs are not read (cf
+  Graph::loadSnapshot()).
+**/
+static int edgeTag(int from_tag, int to_tag) {
+    size_t seed = from_tag;
+    hash_combine(seed, to_tag);
+    return seed;
+}
+
+Edge::Edge(const Node& from, const Node& to, relation_type type, Symbol label) :
+    node1(from.handle),
+    node2(to.handle),
+    rel_type(type),
     renderer(EdgeRenderer(
-            hash_value(rel.from->getID() + rel.to->getID()),
+            edgeTag(from.renderer.getTagID(), to.renderer.getTagID()),
             label,
             rel_type
             ))
@@ -47,18 +56,27 @@ Edge::Edge(const NodeRelation& rel, const string& label) :
 
     spring_constant = INITIAL_SPRING_CONSTANT;
     nominal_length = NOMINAL_EDGE_LENGTH;
-
-    length = 0.0;
 }
 
-void Edge::step(Graph& g, float dt){
+Edge::Edge(NodeHandle from, int from_tag, NodeHandle to, int to_tag, relation_type type, Symbol label) :
+    node1(from),
+    node2(to),
+    rel_type(type),
+    renderer(EdgeRenderer(edgeTag(from_tag, to_tag), label, rel_type))
+{
+    spring_constant = INITIAL_SPRING_CONSTANT;
+    nominal_length = NOMINAL_EDGE_LENGTH;
+}
 
-    updateLength();
+void Edge::updateRenderer(const Graph& graph, float dt){
 
 #ifndef TEXT_ONLY
 
-    const vec2f& pos1 = node1->pos;
-    const vec2f& pos2 = node2->pos;
+    const Node& n1 = graph.getNode(node1);
+    const Node& n2 = graph.getNode(node2);
+
+    const vec2f& pos1 = n1.render_pos;
+    const vec2f& pos2 = n2.render_pos;
 
     //update the spline point
     vec2f td = (pos2 - pos1) * 0.5;
@@ -77,53 +95,51 @@ void Edge::step(Graph& g, float dt){
     td.normalize();
 
     vec2f out_of_node1_distance = td * (
-                (node1->selected ? NODE_SIZE * SELECT_SIZE_FACTOR : NODE_SIZE) / 2 + 2
+                (n1.selected ? NODE_SIZE * SELECT_SIZE_FACTOR : NODE_SIZE) / 2 + 2
                 );
 
     vec2f out_of_node2_distance = td * (
-                (node2->selected ? NODE_SIZE * SELECT_SIZE_FACTOR : NODE_SIZE) / 2 + 2
+                (n2.selected ? NODE_SIZE * SELECT_SIZE_FACTOR : NODE_SIZE) / 2 + 2
                 );
 
-    (node1->selected || node2->selected) ? renderer.selected = true : renderer.selected = false;
+    (n1.selected || n2.selected) ? renderer.selected = true : renderer.selected = false;
     //Update the age of the node renderer
     renderer.increment_idle_time(dt);
 
-    renderer.update(pos1 + out_of_node1_distance , node1->renderer.col,
-                    pos2  - out_of_node2_distance , node2->renderer.col, spos);
+    renderer.update(pos1 + out_of_node1_distance , n1.renderer.col,
+                    pos2  - out_of_node2_distance , n2.renderer.col, spos);
 
 #endif
-    //TRACE("Edge between " << node1->getID() << " and " << node2->getID() << " updated.");
+    //TRACE("Edge between " << n1.getID() << " and " << n2.getID() << " updated.");
 
 }
 
-void Edge::render(rendering_mode mode, OroView& env){
+void Edge::render(rendering_mode mode, OroView& env, const Graph& graph){
 
 
 
 #ifndef TEXT_ONLY
-    int distance = std::min(node1->distance_to_selected, node2->distance_to_selected);
+    const Node& n1 = graph.getNode(node1);
+    const Node& n2 = graph.getNode(node2);
+
+    int distance = std::min(n1.distance_to_selected, n2.distance_to_selected);
     if (distance >= MAX_NODE_LEVELS - 1) return;
 
     if (mode == GRAPHVIZ) {
-        env.graphvizGraph << node1->getSafeID() << " -> " << node2->getSafeID() << ";\n";
+        env.graphvizGraph << n1.getSafeID() << " -> " << n2.getSafeID() << ";\n";
         return;
     }
 
     renderer.draw(mode, env, distance);
 #endif
-    //TRACE("Edge between " << node1->getID() << " and " << node2->getID() << " rendered.");
-
-}
+    //TRACE("Edge between " << n1.getID() << " and " << n2.getID() << " rendered.");
 
-void Edge::updateLength() {
-    //TODO: optimisation by using length2 here?
-    length = (node1->pos -  node2->pos).length();
 }
 
-const string& Edge::getId1() const {
-    return node1->getID();
+NodeHandle Edge::getNode1() const {
+    return node1;
 }
 
-const string& Edge::getId2() const {
-    return node2->getID();
+NodeHandle Edge::getNode2() const {
+    return node2;
 }
@@ -22,20 +22,18 @@
 
 #include "edge_renderer.h"
 #include "styles.h"
+#include "node_handle.h"
 
 class OroView;
 class Graph;
 class Node;
-class NodeRelation;
 
 class Edge
 {
-    Node* node1;
-    Node* node2;
+    NodeHandle node1;
+    NodeHandle node2;
     relation_type rel_type;
 
-    void updateLength();
-
     vec2f spos;
 
     bool stepDone;
@@ -44,9 +42,15 @@ class Edge
     EdgeRenderer renderer;
 
 public:
-    Edge(const NodeRelation& rel, const std::string& label = "");
+    Edge(const Node& from, const Node& to, relation_type type, Symbol label = Symbol());
+
+    /**
+      Edge between two nodes known by their handle and their tag (cf
+      NodeRenderer::getTagID()): the nodes are not read, eg when a snapshot
+      is loaded (cf Graph::loadSnapshot()).
+      */
+    Edge(NodeHandle from, int from_tag, NodeHandle to, int to_tag, relation_type type, Symbol label);
 
-    float length;
     float spring_constant;
     float nominal_length;
 
@@ -58,11 +62,24 @@ public:
     //int countRelations() const;
     //bool hasOutboundConnectionFrom(const Node* node) const;
 
-    void step(Graph& g, float dt);
-    void render(rendering_mode mode, OroView& env);
+    /**
+      Updates the shape of the edge spline, from the rendering position of its
+      nodes. Relies on the OpenGL state: must be called from the rendering
+      thread.
+      */
+    void updateRenderer(const Graph& graph, float dt);
+    void render(rendering_mode mode, OroView& env, const Graph& graph);
+
+    NodeHandle getNode1() const;
+    NodeHandle getNode2() const;
+
+    relation_type getType() const {return rel_type;}
+    Symbol getLabel() const {return renderer.getLabel();}
 
-    const std::string& getId1() const;
-    const std::string& getId2() const;
+    /**
+      Bytes allocated by the renderer of the edge (its spline).
+      */
+    size_t rendererMemoryUsage() const {return renderer.memoryUsage();}
 
 };
 
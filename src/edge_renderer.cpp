@@ -23,7 +23,7 @@
 
 using namespace std;
 
-EdgeRenderer::EdgeRenderer(int tagid, const string& label, relation_type type) :
+EdgeRenderer::EdgeRenderer(int tagid, Symbol label, relation_type type) :
     tagid(tagid),
     label(label),
     type(type),
@@ -119,7 +119,7 @@ void EdgeRenderer::drawName(FXFont& font){
     glPushMatrix();
     glLoadIdentity();
 
-    font.draw(screenpos.x, screenpos.y, label);
+    font.draw(screenpos.x, screenpos.y, label.str());
 
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
@@ -25,6 +25,7 @@
 
 #include "styles.h"
 #include "spline.h"
+#include "string_pool.h"
 
 class OroView;
 
@@ -36,7 +37,7 @@ class EdgeRenderer
 
     vec2f label_pos;
 
-    std::string label;
+    Symbol label;
     relation_type type;
 
     SplineEdge spline;
@@ -55,12 +56,16 @@ public:
 
     void increment_idle_time(float dt);
 
-    EdgeRenderer(int tagid, const std::string& label = "", relation_type type = UNDEFINED);
+    EdgeRenderer(int tagid, Symbol label = Symbol(), relation_type type = UNDEFINED);
 
     void draw(rendering_mode mode, OroView& env, int distance_to_selected);
 
     void update(vec2f pos1, vec4f col1, vec2f pos2, vec4f col2, vec2f spos);
 
+    Symbol getLabel() const {return label;}
+
+    size_t memoryUsage() const {return spline.memoryUsage();}
+
 };
 
 #endif // EDGE_RENDERER_H
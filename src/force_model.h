@@ -0,0 +1,110 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FORCE_MODEL_H
+#define FORCE_MODEL_H
+
+#include "core/vectors.h"
+
+#include "physics_store.h"
+#include "physics_kernels.h"
+#include "barnes_hut.h"
+#include "uniform_grid.h"
+
+/**
+  Constants of the force model for one step. They are read from the
+  configuration once, at the beginning of the step: the inner loops of the
+  physics never read the (mutable) globals of constants.h.
+  */
+struct ForceParameters {
+    float coulomb_constant;
+    float max_speed;
+    float min_energy;
+    float lod_theta;
+};
+
+/**
+  What the repulsion policies below may use. The tree and the grid are only
+  up to date for the engines that use them.
+  */
+struct RepulsionSources {
+    const PhysicsKernels* kernels;
+    const BarnesHutTree* tree;
+    const UniformGrid* grid;
+    ForceParameters params;
+};
+
+/*
+  Policies of the force model. The force pass of the physics step (cf
+  Graph::forcePass) is a template instantiated once per combination of
+  policies, and the instance matching the configuration is picked once per
+  step: nothing is decided per node in the inner loops.
+
+  A repulsion policy sets (fx, fy) of node i of the store to the repulsion
+  applied by all the other nodes, from their positions (x, y).
+
+  An attraction policy gives the intensity of the force of an edge of a
+  given length (positive values pull both ends together).
+*/
+
+/** Exact O(N) repulsion, with the (SIMD) physics kernels.
+**/
+struct ExactRepulsion {
+    static inline void apply(const RepulsionSources& s, PhysicsStore& store, int i) {
+        s.kernels->repulsion(store, i, i + 1, s.params.coulomb_constant);
+    }
+};
+
+/** Barnes-Hut approximation, with the opening angle of the tree.
+**/
+struct BarnesHutRepulsion {
+    static inline void apply(const RepulsionSources& s, PhysicsStore& store, int i) {
+        vec2f f = s.tree->repulsionAt(vec2f(store.x[i], store.y[i]), store.charge[i], i);
+        store.fx[i] = f.x;
+        store.fy[i] = f.y;
+    }
+};
+
+/** Short-range repulsion, from the nodes closer than the grid cutoff.
+**/
+struct GridRepulsion {
+    static inline void apply(const RepulsionSources& s, PhysicsStore& store, int i) {
+        vec2f f = s.grid->repulsionAt(vec2f(store.x[i], store.y[i]), store.charge[i], i);
+        store.fx[i] = f.x;
+        store.fy[i] = f.y;
+    }
+};
+
+/** Coarse Barnes-Hut aggregate, used for the nodes out of focus (cf LOD_THETA).
+**/
+struct CoarseRepulsion {
+    static inline void apply(const RepulsionSources& s, PhysicsStore& store, int i) {
+        vec2f f = s.tree->repulsionAt(vec2f(store.x[i], store.y[i]), store.charge[i], i, s.params.lod_theta);
+        store.fx[i] = f.x;
+        store.fy[i] = f.y;
+    }
+};
+
+/** Hooke's law: the force is proportional to the elongation of the edge.
+**/
+struct HookeAttraction {
+    static inline float force(float spring_constant, float length, float nominal_length) {
+        return spring_constant * (length - nominal_length);
+    }
+};
+
+#endif // FORCE_MODEL_H
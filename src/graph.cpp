@@ -17,7 +17,12 @@
 
 #include <boost/foreach.hpp>
 #include <boost/functional/hash.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
+#include <cmath>
+#include <algorithm>
 #include <iterator>
 #include <utility>
 #include <fstream>
@@ -28,154 +33,1134 @@
 #include "graph.h"
 #include "edge.h"
 #include "node_relation.h"
+#include "multilevel_layout.h"
+#include "snapshot_file.h"
+#include "coulomb.h"
 
 using namespace std;
 using namespace boost;
-
-Graph::Graph()
+using namespace boost::placeholders;
+
+// Below this length (in pixels), the direction of an edge is meaningless.
+static const float MIN_SPRING_LENGTH = 1e-6;
+
+Graph::Graph() :
+    activity_clock(0),
+    kernels(&selectPhysicsKernels(USE_SIMD)),
+    total_energy(0.0),
+    max_displacement(0.0),
+    rest_time(0.0),
+    at_rest(false),
+    decaying(false),
+    fading(false),
+    lod_active(false),
+    lod_tick(0),
+    focused_count(0),
+    batch_depth(0),
+    batch_edges(0),
+    stressLayout(workers),
+    stress_dirty(true),
+    stress_initialised(false),
+    topology_dirty(false),
+    nodes_reindexed(false)
 {
+    string_holder = StringPool::addHolder(boost::bind(&Graph::markSymbols, this, _1));
+}
+
+Graph::~Graph() {
+    StringPool::removeHolder(string_holder);
+}
+
+void Graph::markSymbols(vector<bool>& marks) const {
+
+    BOOST_FOREACH(const Node& node, nodes) {
+        marks[node.getIDSymbol().raw()] = true;
+        marks[node.renderer.getLabelSymbol().raw()] = true;
+    }
+
+    BOOST_FOREACH(const Edge& edge, edges) {
+        marks[edge.getLabel().raw()] = true;
+    }
+
+    for (int r = 0; r < relations.size(); ++r)
+        marks[relations.label(r).raw()] = true;
 }
 
 
 void Graph::step(float dt) {
 
+    // Nothing moves until the graph is modified (cf resume())
+    if (at_rest) return;
+
+    workers.setThreadsCount(PHYSICS_THREADS);
+
+    if (LAYOUT_SOLVER == STRESS_SOLVER) {
+        stepStress(dt);
+        return;
+    }
+
+    kernels = &selectPhysicsKernels(USE_SIMD);
+
+    sources.kernels = kernels;
+    sources.tree = &repulsionTree;
+    sources.grid = &repulsionGrid;
+    sources.params.coulomb_constant = COULOMB_CONSTANT;
+    sources.params.max_speed = MAX_SPEED;
+    sources.params.min_energy = MIN_KINETIC_ENERGY;
+    sources.params.lod_theta = LOD_THETA;
+
+    physics.resize(nodes.size());
+
+    selectSteppedNodes();
+
+    // When every node sleeps, the layout is stable: nothing to simulate.
+    if (!steppedNodes.empty()) {
+
+        // Nodes that are not stepped still repulse (and pull) the other
+        // ones: the whole store is kept up to date.
+        workers.parallelFor(nodes.size(), boost::bind(&Graph::loadNodes, this, _1, _2));
+
+        // Out of focus nodes always use the Barnes-Hut tree
+        if (REPULSION_ENGINE == BARNES_HUT_ENGINE || lod_active)
+            updateRepulsionTree();
+        if (REPULSION_ENGINE == GRID_ENGINE)
+            updateRepulsionGrid();
+
+        void (Graph::*pass)(int, int);
+
+        if (REPULSION_ENGINE == EXACT_ENGINE)
+            pass = &Graph::forcePass<ExactRepulsion, HookeAttraction>;
+        else if (REPULSION_ENGINE == GRID_ENGINE)
+            pass = &Graph::forcePass<GridRepulsion, HookeAttraction>;
+        else
+            pass = &Graph::forcePass<BarnesHutRepulsion, HookeAttraction>;
+
+        workers.parallelFor(steppedNodes.size(), boost::bind(pass, this, _1, _2));
+
+        applyGravity();
+
+        workers.parallelFor(steppedNodes.size(), boost::bind(&Graph::integrateNodes, this, _1, _2, dt));
+
+        // Only once every node has been stepped, their new positions are made visible.
+        workers.parallelFor(steppedNodes.size(), boost::bind(&Graph::commitNodes, this, _1, _2));
+    }
+
+    updateConvergence(dt);
+    updateActiveNodes(dt);
+
+    lod_tick++;
+}
+
+void Graph::stepStress(float dt) {
+
+    if (stress_dirty) {
+        stressLayout.setup(adjacency, STRESS_PIVOTS);
+        stress_dirty = false;
+    }
+
+    stress_positions.resize(nodes.size());
+
+    if (!stress_initialised) {
+        stressLayout.initialise(stress_positions);
+        stress_initialised = true;
+    }
+    else {
+        for (size_t i = 0; i < nodes.size(); ++i) stress_positions[i] = nodes[i].pos;
+    }
+
+    double previous_stress = stressLayout.stress();
+    max_displacement = stressLayout.iterate(stress_positions);
+
+    // No kinetic energy here: convergence is told by the stress (below)
+    total_energy = 0.0;
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        Node& node = nodes[i];
+
+        node.pos = stress_positions[i];
+        node.speed = vec2f(0.0, 0.0);
+        node.kinetic_energy = 0.0;
+    }
+
+    // Still once the stress does not decrease anymore, or once nodes barely
+    // move (the stress of a converged layout jitters with the rounding)
+    double decrease = previous_stress - stressLayout.stress();
+    updateRest(dt, decrease <= STRESS_TOLERANCE * stressLayout.stress() ||
+                   max_displacement <= REST_DISPLACEMENT);
+}
+
+float Graph::stress() const {
+    return stressLayout.stress();
+}
+
+void Graph::computeInitialLayout() {
+
+    workers.setThreadsCount(PHYSICS_THREADS);
+
+    vector<vec2f> positions;
+
+    if (LAYOUT_SOLVER == STRESS_SOLVER) {
+        stressLayout.setup(adjacency, STRESS_PIVOTS);
+        stressLayout.initialise(positions);
+        stress_dirty = false;
+        stress_initialised = true;
+
+        TRACE("Initial layout computed (pivot MDS, " << stressLayout.pivotsCount() << " pivots)");
+    }
+    else {
+        MultilevelLayout layout(workers);
+        layout.run(adjacency, positions);
+
+        TRACE("Initial layout computed (" << layout.levelsCount() << " levels)");
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        Node& node = nodes[i];
+
+        node.pos = node.render_pos = positions[i];
+        node.speed = vec2f(0.0, 0.0);
+        wakeNode(i);
+    }
+
+    resume();
+
+    // Publish twice, so that no interpolation from the former positions occurs
+    publishPositions();
+    publishPositions();
+}
+
+void Graph::storeLayout(LayoutCache& cache) const {
+
+    cache.clear();
+
+    BOOST_FOREACH(const Node& node, nodes) {
+        cache.set(node.getID(), node.pos);
+    }
+}
+
+int Graph::applyLayout(const LayoutCache& cache) {
+
+    int found = 0;
+    vector<bool> cached(nodes.size(), false);
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (cache.get(nodes[i].getID(), nodes[i].pos)) {
+            cached[i] = true;
+            found++;
+        }
+    }
+
+    // New nodes (not in the cache) go next to an already placed neighbour
+    vector<bool> placed(cached);
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (placed[i]) continue;
+
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            if (!placed[n->node]) continue;
+
+            float x = rng.uniform(-5.0, 5.0);
+            float y = rng.uniform(-5.0, 5.0);
+
+            nodes[i].pos = nodes[n->node].pos + vec2f(x, y);
+            placed[i] = true;
+            break;
+        }
+    }
+
+    // The cached layout is already settled: its nodes start asleep. Only the
+    // new nodes, and their neighbours, are simulated.
+    activeNodes.clear();
+
+    BOOST_FOREACH(Node& node, nodes) {
+        node.render_pos = node.pos;
+        node.speed = vec2f(0.0, 0.0);
+        node.kinetic_energy = 0.0;
+        node.asleep = true;
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!cached[i]) wake(nodes[i]);
+    }
+
+    resume();
+
+    // Publish twice, so that no interpolation from the former positions occurs
+    publishPositions();
+    publishPositions();
+
+    // The stress solver starts from the cached layout
+    stress_initialised = true;
+
+    return found;
+}
+
+/** Index of a string in the string table of a snapshot, added if needed.
+**/
+static boost::uint32_t snapshotString(Symbol symbol,
+                                      SnapshotFile::Content& content,
+                                      unordered_map<uint32_t, boost::uint32_t>& indices) {
+
+    unordered_map<uint32_t, boost::uint32_t>::const_iterator it = indices.find(symbol.raw());
+    if (it != indices.end()) return it->second;
+
+    indices.insert(make_pair(symbol.raw(), (boost::uint32_t) content.strings.size()));
+    content.strings.push_back(symbol);
+
+    return content.strings.size() - 1;
+}
+
+void Graph::saveSnapshot(const string& path) const {
+
+    SnapshotFile::Content content;
+    unordered_map<uint32_t, boost::uint32_t> indices;
+
+    content.nodes.reserve(nodes.size());
+    content.positions.reserve(nodes.size());
+
+    BOOST_FOREACH(const Node& node, nodes) {
+        SnapshotFile::NodeRecord record;
+        record.id = snapshotString(node.getIDSymbol(), content, indices);
+        record.label = snapshotString(node.renderer.getLabelSymbol(), content, indices);
+        record.type = node.renderer.getType();
+        record.tag = node.renderer.getTagID();
+        content.nodes.push_back(record);
+
+        SnapshotFile::PositionRecord position;
+        position.x = node.pos.x;
+        position.y = node.pos.y;
+        content.positions.push_back(position);
+    }
+
+    content.edges.reserve(edges.size());
+
+    BOOST_FOREACH(const Edge& edge, edges) {
+        SnapshotFile::LinkRecord record;
+        record.from = nodes.indexOf(edge.getNode1());
+        record.to = nodes.indexOf(edge.getNode2());
+        record.type = edge.getType();
+        record.label = snapshotString(edge.getLabel(), content, indices);
+        content.edges.push_back(record);
+    }
+
+    content.relations.reserve(relations.size());
+
+    for (int r = 0; r < relations.size(); ++r) {
+        SnapshotFile::LinkRecord record;
+        record.from = relations.from(r);
+        record.to = relations.to(r);
+        record.type = relations.type(r);
+        record.label = snapshotString(relations.label(r), content, indices);
+        content.relations.push_back(record);
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        pair<AliasKeys::const_iterator, AliasKeys::const_iterator> aliases = alias_keys.equal_range(nodes.handleAt(i).raw());
+
+        for (AliasKeys::const_iterator it = aliases.first; it != aliases.second; ++it) {
+            SnapshotFile::AliasRecord record;
+            record.node = i;
+            record.key = it->second;
+            content.aliases.push_back(record);
+        }
+    }
+
+    // Keys of the IDs and aliases, whether in 'ids' or in the mapped snapshot
+    content.ids.reserve(ids.size() + (mapped_snapshot ? mapped_snapshot->header().id_slots : 0));
+
+    BOOST_FOREACH(const IdIndex::value_type& id, ids) {
+        SnapshotFile::IdSlot record;
+        record.key = id.first;
+        record.node = nodes.indexOf(id.second);
+        content.ids.push_back(record);
+    }
+
+    if (mapped_snapshot) {
+        const SnapshotFile::IdSlot* id_slots = mapped_snapshot->idSlots();
+
+        for (boost::uint32_t s = 0; s < mapped_snapshot->header().id_slots; ++s) {
+            if (id_slots[s].node != SnapshotFile::EMPTY) content.ids.push_back(id_slots[s]);
+        }
+    }
+
+    SnapshotFile::save(path, content);
+
+    cout << "Graph of " << nodes.size() << " nodes saved to " << path << endl;
+}
+
+bool Graph::loadSnapshot(const string& path) {
+
+    if (!nodes.empty())
+        throw OroViewException("Snapshots can only be loaded into an empty graph");
+
+    boost::shared_ptr<SnapshotFile> file = SnapshotFile::open(path);
+    if (!file) return false;
+
+    const SnapshotFile::Header& header = file->header();
+
+    // The strings stay in the file
+    vector<Symbol> symbols;
+    StringPool::addTable(file->strings(), file, symbols);
+
+    nodes.reserve(header.nodes);
+
+    const SnapshotFile::NodeRecord* node_records = file->nodes();
+    const SnapshotFile::PositionRecord* positions = file->positions();
+    const SnapshotFile::LinkRecord* edge_records = file->edges();
+    const SnapshotFile::LinkRecord* relation_records = file->relations();
+
+    // The saved layout is already settled: the nodes start asleep
+    for (boost::uint32_t i = 0; i < header.nodes; ++i) {
+        const SnapshotFile::NodeRecord& record = node_records[i];
+
+        NodeHandle handle = nodes.insert(Node(symbols[record.id], record.tag, symbols[record.label],
+                                              (node_type) record.type, vec2f(positions[i].x, positions[i].y)));
+
+        Node& node = nodes[i];
+        node.handle = handle;
+        node.index = i;
+        node.asleep = true;
+
+        touch(node);
+    }
+
+    edges.reserve(header.edges);
+
+    for (boost::uint32_t e = 0; e < header.edges; ++e) {
+        const SnapshotFile::LinkRecord& record = edge_records[e];
+
+        edges.push_back(Edge(nodes.handleAt(record.from), node_records[record.from].tag,
+                             nodes.handleAt(record.to), node_records[record.to].tag,
+                             (relation_type) record.type, symbols[record.label]));
+    }
+
+    relations.reserve(header.relations);
+
+    for (boost::uint32_t r = 0; r < header.relations; ++r) {
+        const SnapshotFile::LinkRecord& record = relation_records[r];
+        relations.appendColumns(record.from, record.to, (relation_type) record.type, symbols[record.label]);
+    }
+
+    // The rows of the indices are built at once
+    vector<boost::uint32_t> offsets;
+    vector<AdjacencyIndex::Neighbour> neighbours;
+
+    file->buildRows(SnapshotFile::ADJACENCY, offsets, neighbours);
+    adjacency.assign(offsets, neighbours);
+
+    file->buildRows(SnapshotFile::OUTGOING, offsets, neighbours);
+    relations.assignOutgoing(offsets, neighbours);
+
+    file->buildRows(SnapshotFile::INCOMING, offsets, neighbours);
+    relations.assignIncoming(offsets, neighbours);
+
+    // The keys of the IDs and aliases are in the ID hash table of the file
+    const SnapshotFile::AliasRecord* alias_records = file->aliases();
+
+    for (boost::uint32_t a = 0; a < header.aliases; ++a) {
+        NodeHandle node = nodes.handleAt(alias_records[a].node);
+        alias_keys.insert(make_pair(node.raw(), (int) alias_records[a].key));
+    }
+
+    mapped_snapshot = file;
+
+    stress_dirty = true;
+    topology_dirty = true;
+    resume();
+
+    // Publish twice, so that no interpolation from the former positions occurs
+    publishPositions();
+    publishPositions();
+
+    // The stress solver starts from the saved layout
+    stress_initialised = true;
+
+    return true;
+}
+
+boost::mutex& Graph::getMutex() {
+    return graph_mutex;
+}
+
+void Graph::publishPositions() {
+    publish(true);
+}
+
+void Graph::publishTopology() {
+    if (topology_dirty) publish(false);
+}
+
+/** Sorts the picking tags of the nodes (cf GraphSnapshot::Topology::tags),
+  pushed in the order of the nodes, by tag: a radix sort, which is stable, so
+  that the result is the same as sorting the pairs.
+**/
+static void sortTags(vector<pair<int, int> >& tags) {
+
+    if (tags.size() < 256) {
+        sort(tags.begin(), tags.end());
+        return;
+    }
+
+    vector<pair<int, int> > sorted(tags.size());
+
+    // 11 bits at a time, the sign bit flipped so that negative tags come first
+    const int BITS = 11;
+    const uint32_t DIGITS = 1 << BITS;
+
+    for (int shift = 0; shift < 32; shift += BITS) {
+        vector<size_t> starts(DIGITS + 1, 0);
+
+        for (size_t i = 0; i < tags.size(); ++i)
+            starts[((((uint32_t) tags[i].first) ^ 0x80000000u) >> shift & (DIGITS - 1)) + 1]++;
+
+        for (uint32_t d = 0; d < DIGITS; ++d)
+            starts[d + 1] += starts[d];
+
+        for (size_t i = 0; i < tags.size(); ++i)
+            sorted[starts[(((uint32_t) tags[i].first) ^ 0x80000000u) >> shift & (DIGITS - 1)]++] = tags[i];
+
+        tags.swap(sorted);
+    }
+}
+
+void Graph::publish(bool stepped) {
+
+    const GraphSnapshot* last = snapshots.latest();
+    GraphSnapshot* snapshot = new GraphSnapshot();
+
+    if (topology_dirty || !last) {
+        GraphSnapshot::Topology* topology = new GraphSnapshot::Topology();
+
+        topology->nodes.reserve(nodes.size());
+        topology->tags.reserve(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            topology->nodes.push_back(nodes.handleAt(i));
+            topology->tags.push_back(make_pair(nodes[i].renderer.getTagID(), (int) i));
+        }
+        sortTags(topology->tags);
+
+        topology->edges.reserve(edges.size());
+        BOOST_FOREACH(const Edge& edge, edges) {
+            topology->edges.push_back(make_pair(nodes.indexOf(edge.getNode1()),
+                                                nodes.indexOf(edge.getNode2())));
+        }
+
+        snapshot->topology.reset(topology);
+    }
+    else snapshot->topology = last->topology;
+
+    std::vector<vec2f>* positions = new std::vector<vec2f>(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+        (*positions)[i] = nodes[i].pos;
+    snapshot->positions.reset(positions);
+
+    // The former positions are only valid as long as the indices of the
+    // nodes did not change. Without a physics step, the nodes did not move
+    // since the last publication: the interpolation goes on unchanged.
+    if (last && !nodes_reindexed)
+        snapshot->previous_positions = stepped ? last->positions : last->previous_positions;
+
+    topology_dirty = false;
+    nodes_reindexed = false;
+
+    snapshots.publish(snapshot);
+}
+
+void Graph::interpolate(float alpha) {
+
+    SnapshotChannel<GraphSnapshot>::Reader snapshot(snapshots);
+    if (!snapshot.get()) return;
+
+    const std::vector<NodeHandle>& handles = snapshot->topology->nodes;
+    const std::vector<vec2f>& current_positions = *snapshot->positions;
+    const std::vector<vec2f>* previous_positions = snapshot->previous_positions.get();
+
+    // Nodes that have not been published yet keep their initial position.
+    // Nodes that have been removed since the snapshot are skipped, and those
+    // that moved to another index are looked up by handle.
+    for (size_t i = 0; i < handles.size(); ++i) {
+        Node* node = i < nodes.size() && nodes.handleAt(i) == handles[i] ? &nodes[i] : nodes.find(handles[i]);
+        if (!node) continue;
+
+        const vec2f& current = current_positions[i];
+        const vec2f& previous = previous_positions && i < previous_positions->size() ? (*previous_positions)[i] : current;
+
+        node->render_pos = previous + (current - previous) * alpha;
+    }
+}
+
+void Graph::decay(float dt) {
+    decaying = false;
+
+    BOOST_FOREACH(Node& node, nodes) {
+        node.updateDecay(dt);
+        decaying = decaying || node.isDecaying();
+    }
+}
+
+void Graph::updateRenderers(float dt) {
+
+    fading = false;
+
+    BOOST_FOREACH(Node& node, nodes) {
+        node.renderer.increment_idle_time(dt);
+        fading = fading || node.renderer.isFading();
+    }
+
+    // Edge splines are projected with the current OpenGL matrices
     BOOST_FOREACH(Edge& e, edges) {
-        e.step(*this, dt);
+        e.updateRenderer(*this, dt);
+    }
+}
+
+void Graph::loadNodes(int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        Node& node = nodes[i];
+
+        // A node whose charge changes (it decays for a while after being
+        // tickled) can not fall asleep.
+        if (fabs(node.charge - physics.charge[i]) > 0.001 * fabs(node.charge))
+            node.calm_time = 0.0;
+
+        physics.x[i] = node.pos.x;
+        physics.y[i] = node.pos.y;
+        physics.vx[i] = node.speed.x;
+        physics.vy[i] = node.speed.y;
+        physics.charge[i] = node.charge;
+        physics.mass[i] = node.mass;
+        physics.damping[i] = node.damping;
     }
+}
+
+template <class Repulsion, class Attraction>
+void Graph::forcePass(int begin, int end) {
+
+    // Nodes in focus come first in steppedNodes
+    int split = CLAMP(focused_count, begin, end);
+
+    applyForces<Repulsion, Attraction>(begin, split);
+    applyForces<CoarseRepulsion, Attraction>(split, end);
+}
+
+template <class Repulsion, class Attraction>
+void Graph::applyForces(int begin, int end) {
+
+    // Algo from Wikipedia -- http://en.wikipedia.org/wiki/Force-based_layout
+    // Every node is repulsed by all the others, and attracted by its
+    // neighbours (cf applyGravity() for selected nodes).
+    const float* x = &physics.x[0];
+    const float* y = &physics.y[0];
+
+    for (int k = begin; k < end; ++k) {
+        int i = steppedNodes[k];
+        Node& node = nodes[i];
+
+        Repulsion::apply(sources, physics, i);
+
+        node.coulombForce = vec2f(physics.fx[i], physics.fy[i]);
+
+        // Coincident nodes have a null delta: their spring force vanishes
+        // without testing the length.
+        float fx = 0.0, fy = 0.0;
 
-    BOOST_FOREACH(NodeMap::value_type& n, nodes) {
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            const Edge& e = edges[n->edge];
 
-        n.second.step(*this, dt);
+            float dx = x[n->node] - x[i];
+            float dy = y[n->node] - y[i];
+            float length = sqrt(dx * dx + dy * dy);
+
+            float w = Attraction::force(e.spring_constant, length, e.nominal_length) / MAX(length, MIN_SPRING_LENGTH);
+
+            fx += w * dx;
+            fy += w * dy;
+        }
+
+        node.hookeForce = vec2f(fx, fy);
+
+        physics.fx[i] += fx;
+        physics.fy[i] += fy;
+    }
+}
+
+void Graph::applyGravity() {
+
+    BOOST_FOREACH(int i, steppedSelected) {
+        Node& node = nodes[i];
+
+        vec2f force = node.coulombForce + gravityFor(node);
+
+        physics.fx[i] = force.x;
+        physics.fy[i] = force.y;
     }
 }
 
-void Graph::render(rendering_mode mode, OroView& env, bool debug) {
+void Graph::integrateNodes(int begin, int end, float dt) {
+
+    const ForceParameters& params = sources.params;
+
+    // Runs of consecutive indices are integrated at once. Nodes in focus
+    // and out of focus do not share the same time step.
+    int k = begin;
+
+    while (k < end) {
+        bool focused = k < focused_count;
+        int limit = focused ? MIN(end, focused_count) : end;
+
+        int run = k + 1;
+        while (run < limit && steppedNodes[run] == steppedNodes[run - 1] + 1) ++run;
+
+        kernels->integrate(physics, steppedNodes[k], steppedNodes[k] + (run - k),
+                           focused ? dt : dt * LOD_DECIMATION,
+                           params.max_speed, params.min_energy);
+        k = run;
+    }
+}
+
+void Graph::commitNodes(int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+        int i = steppedNodes[k];
+        Node& node = nodes[i];
+
+        node.pos = vec2f(physics.next_x[i], physics.next_y[i]);
+        node.speed = vec2f(physics.vx[i], physics.vy[i]);
+        node.kinetic_energy = physics.kinetic_energy[i];
+    }
+}
+
+void Graph::wakeNode(int index) {
+    Node& node = nodes[index];
+
+    node.calm_time = 0.0;
+
+    if (!node.asleep) return;
+
+    node.asleep = false;
+    activeNodes.push_back(index);
+}
+
+void Graph::wake(Node& node) {
+    resume();
+    touch(node);
+
+    wakeNode(node.index);
+
+    for (AdjacencyIndex::const_iterator n = adjacency.begin(node.index);
+         n != adjacency.end(node.index); ++n) {
+        wakeNode(n->node);
+    }
+}
+
+int Graph::activeNodesCount() const {
+    return activeNodes.size();
+}
+
+int Graph::steppedNodesCount() const {
+    return steppedNodes.size();
+}
+
+bool Graph::inFocus(const Node& node) const {
+    return !lod_active ||
+           (node.distance_to_selected_updated && node.distance_to_selected < FOCUS_RADIUS);
+}
+
+float Graph::stepTimeFor(const Node& node, float dt) const {
+    return inFocus(node) ? dt : dt * LOD_DECIMATION;
+}
+
+void Graph::selectSteppedNodes() {
+
+    lod_active = FOCUS_RADIUS > 0 && !selectedNodes.empty();
+
+    // Out of focus nodes are stepped in turn, every LOD_DECIMATION ticks.
+    // Nodes are marked first, then collected by index: the stepped nodes
+    // come sorted, the ones in focus first.
+    stepped_marks.assign(nodes.size(), 0);
+
+    BOOST_FOREACH(int i, activeNodes) {
+        if (inFocus(nodes[i]))
+            stepped_marks[i] = 1;
+        else if (LOD_DECIMATION > 0 && (lod_tick + i) % LOD_DECIMATION == 0)
+            stepped_marks[i] = 2;
+    }
+
+    steppedNodes.clear();
+
+    for (size_t i = 0; i < stepped_marks.size(); ++i)
+        if (stepped_marks[i] == 1) steppedNodes.push_back(i);
+
+    focused_count = steppedNodes.size();
+
+    for (size_t i = 0; i < stepped_marks.size(); ++i)
+        if (stepped_marks[i] == 2) steppedNodes.push_back(i);
+
+    steppedSelected.clear();
+
+    BOOST_FOREACH(NodeHandle node, selectedNodes) {
+        int i = nodes.indexOf(node);
+        if (stepped_marks[i]) steppedSelected.push_back(i);
+    }
+}
+
+void Graph::updateConvergence(float dt) {
+
+    // Sleeping nodes do not move: only the stepped ones are considered.
+    total_energy = 0.0;
+    max_displacement = 0.0;
+
+    BOOST_FOREACH(int i, steppedNodes) {
+        total_energy += physics.kinetic_energy[i];
+
+        vec2f displacement(physics.next_x[i] - physics.x[i], physics.next_y[i] - physics.y[i]);
+        max_displacement = MAX(max_displacement, displacement.length());
+    }
+
+    updateRest(dt, total_energy <= REST_ENERGY * nodes.size() && max_displacement <= REST_DISPLACEMENT);
+}
+
+void Graph::updateRest(float dt, bool still) {
+
+    if (REST_DELAY <= 0.0) return;
+
+    if (!still) {
+        rest_time = 0.0;
+        return;
+    }
+
+    rest_time += dt;
+
+    if (rest_time > REST_DELAY) {
+        TRACE("The graph is at rest (energy: " << total_energy << "). Simulation suspended.");
+        at_rest = true;
+    }
+}
+
+void Graph::resume() {
+    rest_time = 0.0;
+
+    if (at_rest) {
+        TRACE("Simulation resumed");
+        at_rest = false;
+    }
+}
+
+bool Graph::isFading() const {
+    return decaying || fading;
+}
+
+bool Graph::isAtRest() const {
+    return at_rest;
+}
+
+float Graph::totalEnergy() const {
+    return total_energy;
+}
+
+float Graph::maxDisplacement() const {
+    return max_displacement;
+}
+
+void Graph::updateActiveNodes(float dt) {
+
+    // Nodes woken up below are appended to activeNodes: they are not
+    // considered before the next step. Active nodes that were not stepped
+    // (out of focus) are left untouched.
+
+    // Nodes that still move wake up their neighbours.
+    BOOST_FOREACH(int i, steppedNodes) {
+        if (physics.kinetic_energy[i] <= SLEEP_ENERGY) continue;
+
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            wakeNode(n->node);
+        }
+    }
+
+    if (SLEEP_DELAY <= 0.0) return;
+
+    BOOST_FOREACH(int i, steppedNodes) {
+        Node& node = nodes[i];
+
+        if (physics.kinetic_energy[i] > SLEEP_ENERGY) {
+            node.calm_time = 0.0;
+            continue;
+        }
+
+        node.calm_time += stepTimeFor(node, dt);
+
+        if (node.calm_time > SLEEP_DELAY) {
+            TRACE("Node " << node.getID() << " falls asleep");
+            node.asleep = true;
+            node.speed = vec2f(0.0, 0.0);
+            node.kinetic_energy = 0.0;
+            physics.vx[i] = physics.vy[i] = 0.0;
+            physics.kinetic_energy[i] = 0.0;
+        }
+    }
+
+    int awake = 0;
+    for (size_t k = 0; k < activeNodes.size(); ++k) {
+        if (!nodes[activeNodes[k]].asleep)
+            activeNodes[awake++] = activeNodes[k];
+    }
+    activeNodes.resize(awake);
+}
+
+const char* Graph::kernelsName() const {
+    return kernels->name;
+}
+
+int Graph::threadsCount() const {
+    return workers.threadsCount();
+}
+
+void Graph::render(rendering_mode mode, OroView& env) {
 
     // Renders edges
     BOOST_FOREACH(Edge& e, edges) {
-        e.render(mode, env);
+        e.render(mode, env, *this);
     }
 
     // Renders nodes
-    BOOST_FOREACH(NodeMap::value_type& n, nodes) {
-        n.second.render(mode, env, debug);
+    BOOST_FOREACH(Node& n, nodes) {
+        n.render(mode, env);
     }
 
 }
 
-const Graph::NodeMap& Graph::getNodes() const {
+void Graph::renderForces() const {
+    BOOST_FOREACH(const Node& n, nodes) {
+        n.renderForces();
+    }
+}
+
+const Graph::NodeSlots& Graph::getNodes() const {
     return nodes;
 }
 
+const RelationTable& Graph::getRelations() const {
+    return relations;
+}
+
 Node& Graph::getNode(const string& id) {
 
-    AliasMap::iterator it = aliases.find(hash_value(id));
+    NodeHandle node = findHandle(id);
 
-    if (it == aliases.end())
+    if (node.isNull())
         throw OroViewException("Node " + id + " not found");
 
-    return *(it->second);
+    return getNode(node);
 
 }
 
 const Node& Graph::getConstNode(const string& id) const {
 
-    AliasMap::const_iterator it = aliases.find(hash_value(id));
+    NodeHandle node = findHandle(id);
 
-    if (it == aliases.end())
+    if (node.isNull())
         throw OroViewException("Node " + id + " not found");
 
-    return *(it->second);
+    return getNode(node);
+
+}
+
+Node& Graph::getNode(NodeHandle node) {
+
+    Node* n = nodes.find(node);
+
+    if (n == NULL)
+        throw OroViewException("Invalid node handle");
+
+    return *n;
+}
+
+const Node& Graph::getNode(NodeHandle node) const {
+
+    const Node* n = nodes.find(node);
+
+    if (n == NULL)
+        throw OroViewException("Invalid node handle");
+
+    return *n;
+}
+
+Node* Graph::findNode(NodeHandle node) {
+    return nodes.find(node);
+}
+
+NodeHandle Graph::findHandle(const string& id) const {
+    return findKey(hash_value(id));
+}
+
+NodeHandle Graph::findKey(int key) const {
+
+    IdIndex::const_iterator it = ids.find(key);
+
+    if (it != ids.end())
+        return it->second;
+
+    if (mapped_snapshot) {
+        boost::uint32_t node = mapped_snapshot->findId(key);
+        if (node != SnapshotFile::EMPTY) return nodes.handleAt(node);
+    }
 
+    return NodeHandle();
 }
 
-Node* Graph::getNodeByTagID(int tagid) {
+NodeHandle Graph::getNodeByTagID(int tagid) const {
 
-    NodeMap::iterator it = nodes.find(tagid);
+    SnapshotChannel<GraphSnapshot>::Reader snapshot(snapshots);
 
-    if (it == nodes.end())
-        return NULL;
+    if (!snapshot.get())
+        return NodeHandle();
 
-    return &(it->second);
+    return snapshot->topology->findTag(tagid);
 
 }
 
 Node& Graph::getRandomNode() {
-    NodeMap::iterator it = nodes.begin();
-    advance( it, rand()%nodes.size());
-    return it->second;
+    return nodes[rng.index(nodes.size())];
 }
 
-void Graph::select(Node *node) {
+void Graph::seed(unsigned int seed) {
+    rng.seed(seed);
+}
+
+RandomGenerator& Graph::random() {
+    return rng;
+}
+
+void Graph::select(NodeHandle handle) {
+
+    Node& node = getNode(handle);
 
    //Already selected?
-    if (node->selected) return;
+    if (node.selected) return;
+
+    node.setSelected(true);
+    selectedNodes.insert(handle);
+    wake(node);
 
-    node->setSelected(true);
-    selectedNodes.insert(node);
+    if (selectedNodes.size() == 1) resetDistances(distanceCap());
 
-    updateDistances();
+    setDistance(node.index, 0);
+    propagateDistances();
 }
 
-void Graph::deselect(Node *node){
+void Graph::deselect(NodeHandle handle){
+
+    Node& node = getNode(handle);
 
     //Already deselected?
-    if (!node->selected) return;
+    if (!node.selected) return;
 
-    node->setSelected(false);
-    selectedNodes.erase(node);
+    node.setSelected(false);
+    selectedNodes.erase(handle);
+    wake(node);
 
-    updateDistances();
+    if (selectedNodes.empty()) resetDistances(-1);
+    else updateDistancesAround(vector<int>(1, node.index));
 }
 
 void Graph::clearSelect(){
-    BOOST_FOREACH(Node* node, selectedNodes) {
-        node->setSelected(false);
+    BOOST_FOREACH(NodeHandle handle, selectedNodes) {
+        Node& node = getNode(handle);
+        node.setSelected(false);
+        wake(node);
     }
 
     selectedNodes.clear();
 
-    updateDistances();
+    resetDistances(-1);
 }
 
 Node* Graph::getSelected() {
     if (selectedNodes.size() == 1)
-        return *selectedNodes.begin();
+        return nodes.find(*selectedNodes.begin());
 
     return NULL;
 }
 
 void Graph::addAlias(const string& alias, const string& id) {
 
-    aliases.insert(make_pair(hash_value(alias),&(getNode(id))));
-}
+    NodeHandle node = getNode(id).handle;
 
-Node& Graph::addNode(const string& id, const string& label, const Node* neighbour, node_type type) {
+    if (!findKey(hash_value(alias)).isNull()) return;
 
-    pair<NodeMap::iterator, bool> res;
+    ids.insert(make_pair(hash_value(alias), node));
+    alias_keys.insert(make_pair(node.raw(), (int) hash_value(alias)));
+}
+
+void Graph::touch(Node& node) {
+    node.last_activity = ++activity_clock;
+}
 
-    //TODO: I'm doing 2 !! copies of Node, here??
+NodeHandle Graph::addNode(const string& id, const string& label, NodeHandle neighbour, node_type type) {
 
-    res = nodes.insert(make_pair(hash_value(id),Node(id, label, neighbour, type)));
+    NodeHandle existing = findKey(hash_value(id));
 
-    if ( ! res.second )
+    if (!existing.isNull()) {
         TRACE("Didn't add node " << id << " because it already exists.");
-    else {
-        TRACE("Added node " << id);
-        aliases.insert(make_pair(hash_value(id),&res.first->second));
-        updateDistances();
+        return existing;
     }
 
-    return res.first->second;
+    // The neighbour must be read before the insertion, which may move it.
+    const Node* n = nodes.find(neighbour);
+    int neighbour_index = (n != NULL) ? n->index : -1;
+
+    NodeHandle handle = nodes.insert(Node(id, label, rng, n, type));
+
+    Node& node = getNode(handle);
+    node.handle = handle;
+    node.index = nodes.indexOf(handle);
+
+    TRACE("Added node " << id);
+    ids.insert(make_pair(hash_value(id), handle));
+    touch(node);
+    adjacency.addNode();
+    relations.addNode();
+    activeNodes.push_back(node.index);
+    stress_dirty = true;
+    topology_dirty = true;
+    resume();
+
+    // The new node is likely to push its neighbour
+    if (neighbour_index >= 0) wakeNode(neighbour_index);
+
+    // Not connected to the selection yet
+    if (!selectedNodes.empty()) node.distance_to_selected = distanceCap();
+
+    return handle;
+}
+
+void Graph::beginBatch() {
+    if (batch_depth++ == 0) batch_edges = 0;
+}
+
+void Graph::commit() {
+
+    if (batch_depth == 0 || --batch_depth > 0) return;
+
+    if (batch_edges == 0) return;
+
+    TRACE("Batch committed (" << batch_edges << " new edges)");
+
+    propagateDistances();
+    adjacency.shrink();
+    relations.shrink();
 }
 
 /**
 Ask the graph to create the edge for this relation. If an edge already exist between the two nodes,
 it will be reused.
 */
-void Graph::addEdge(Node& from, Node& to, const relation_type type, const std::string& label) {
+void Graph::addEdge(NodeHandle from_handle, NodeHandle to_handle, const relation_type type, const std::string& label) {
+
+    Node& from = getNode(from_handle);
+    Node& to = getNode(to_handle);
+
+    Symbol symbol(label);
 
-    NodeRelation& rel = from.addRelation(to, type, label);
+    relations.add(from.index, to.index, type, symbol);
 
     //Don't add an edge if the relation is between the same node.
     //It could be actually useful, but it provokes a segfault somewhere :-/
@@ -184,9 +1169,28 @@ void Graph::addEdge(Node& from, Node& to, const relation_type type, const std::s
         return;
     }
 
-    if (getEdgesBetween(from, to).size() == 0)
+    if (!hasEdgeBetween(from_handle, to_handle)) {
         //so now we are confident that there's no edge we can reuse. Let's create a new one.
-        edges.push_back(Edge(rel, label));
+        edgeIndex.insert(make_pair(edgeKey(from_handle, to_handle), (int) edges.size()));
+        edges.push_back(Edge(from, to, type, symbol));
+        adjacency.addEdge(from.index, to.index, edges.size() - 1);
+
+        // The new edge may bring nodes closer to the selection. In a batch,
+        // the new distances are propagated by commit().
+        if (!selectedNodes.empty()) {
+            setDistance(to.index, from.distance_to_selected + 1);
+            setDistance(from.index, to.distance_to_selected + 1);
+            if (batch_depth == 0) propagateDistances();
+        }
+
+        batch_edges++;
+        stress_dirty = true;
+        topology_dirty = true;
+
+        wakeNode(from.index);
+        wakeNode(to.index);
+        resume();
+    }
 
 
     return;
@@ -194,59 +1198,567 @@ void Graph::addEdge(Node& from, Node& to, const relation_type type, const std::s
 
 
 
+bool Graph::addNodeConnectedTo(const string& id,
+                               const string& node_label,
+                               const string& to,
+                               relation_type type,
+                               const string& edge_label,
+                               bool only_labelled_nodes){
+
+    NodeHandle n;
+    NodeHandle neighbour;
+
+    string label = node_label;
+
+    try {
+        neighbour = getNode(to).handle;
+    }
+    catch(OroViewException& exception) {
+        //neighbour not found, create it.
+        TRACE("Neighbour " << to << " not found. Creating it.");
+
+        addNodeConnectedTo(to, to, ROOT_CONCEPT, UNDEFINED, "", only_labelled_nodes);
+        neighbour = getNode(to).handle;
+    }
+
+    try {
+        //does the node already exists?
+
+        //if yes, reuse it
+        n = getNode(id).handle;
+    }
+    catch(OroViewException& exception) {
+        //if not, create it, create it.
+        TRACE("Not existing myself (" << id << "). Creating myself.");
+
+        node_type ntype;
+
+        //guess the type of the node we are adding
+        switch (type) {
+        case SUBCLASS:
+        case SUPERCLASS:
+        case CLASS:
+            ntype = CLASS_NODE;
+            break;
+
+        case INSTANCE:
+            ntype = INSTANCE_NODE;
+            break;
+
+        case PROPERTY:
+        case OBJ_PROPERTY:
+        case DATA_PROPERTY:
+            if (starts_with(id, "literal")) {
+                if (node_label == "true"){
+                    ntype = TRUE_NODE;
+                    label = "";
+                }
+                else if (node_label == "false"){
+                    ntype = FALSE_NODE;
+                    label = "";
+                }
+                else ntype = LITERAL_NODE;
+
+            }
+            else ntype = INSTANCE_NODE;
+            break;
+
+        case COMMENT:
+            ntype = COMMENT_NODE;
+            break;
+
+        default:
+            TRACE("Default type of node? strange...");
+            ntype = INSTANCE_NODE;
+        }
+
+        if (only_labelled_nodes &&
+            ntype == CLASS_NODE &&
+            label == id) { //no a very robust way to check if a node has a label, but it's fast
+
+            TRACE("Node " << id << " has no label, discarding it.");
+            return false;
+        }
+
+        n = addNode(id, label, neighbour, ntype);
+    }
+
+    addEdge(n, neighbour, type, edge_label);
+
+    return true;
+}
+
 vector<const Edge*>  Graph::getEdgesFor(const Node& node) const{
     vector<const Edge*> res;
 
-    BOOST_FOREACH(const Edge& e, edges) {
-        if (e.getId1() == node.getID() ||
-                e.getId2() == node.getID())
-            res.push_back(&e);
+    for (AdjacencyIndex::const_iterator n = adjacency.begin(node.index);
+         n != adjacency.end(node.index); ++n) {
+        res.push_back(&edges[n->edge]);
     }
     return res;
 }
 
-vector<Edge*>  Graph::getEdgesBetween(const Node& node1, const Node& node2){
-    vector<Edge*> res;
+uint64_t Graph::edgeKey(NodeHandle node1, NodeHandle node2) {
+    uint64_t a = node1.raw();
+    uint64_t b = node2.raw();
 
-    BOOST_FOREACH(Edge& e, edges) {
-        if ((e.getId1() == node1.getID() && e.getId2() == node2.getID()) ||
-                (e.getId1() == node2.getID() && e.getId2() == node1.getID()))
-            res.push_back(&e);
+    return a < b ? (a << 32) | b : (b << 32) | a;
+}
+
+int Graph::findEdge(NodeHandle node1, NodeHandle node2) const {
+
+    EdgeIndex::const_iterator it = edgeIndex.find(edgeKey(node1, node2));
+
+    if (it != edgeIndex.end())
+        return it->second;
+
+    if (mapped_snapshot) {
+        // Nodes added since the snapshot was loaded are not in the file
+        int index1 = nodes.indexOf(node1);
+        int index2 = nodes.indexOf(node2);
+        int loaded = mapped_snapshot->header().nodes;
+
+        if (index1 >= 0 && index2 >= 0 && index1 < loaded && index2 < loaded) {
+            boost::uint32_t e = mapped_snapshot->findEdge(index1, index2);
+            if (e != SnapshotFile::EMPTY) return e;
+        }
     }
-    return res;
+
+    return -1;
+}
+
+Graph::EdgeRange Graph::getEdgesBetween(const Node& node1, const Node& node2){
+
+    int index = findEdge(node1.handle, node2.handle);
+
+    if (index < 0)
+        return EdgeRange(NULL, NULL);
+
+    Edge* e = &edges[index];
+    return EdgeRange(e, e + 1);
+}
+
+bool Graph::hasEdgeBetween(NodeHandle node1, NodeHandle node2) const {
+    return findEdge(node1, node2) >= 0;
+}
+
+void Graph::unmapSnapshot() {
+
+    if (!mapped_snapshot) return;
+
+    const SnapshotFile::Header& header = mapped_snapshot->header();
+
+    ids.reserve(ids.size() + header.nodes + header.aliases);
+
+    const SnapshotFile::IdSlot* id_slots = mapped_snapshot->idSlots();
+    for (boost::uint32_t s = 0; s < header.id_slots; ++s) {
+        if (id_slots[s].node != SnapshotFile::EMPTY)
+            ids.insert(make_pair((int) id_slots[s].key, nodes.handleAt(id_slots[s].node)));
+    }
+
+    edgeIndex.reserve(edgeIndex.size() + header.edges);
+
+    const SnapshotFile::LinkRecord* edge_records = mapped_snapshot->edges();
+    for (boost::uint32_t e = 0; e < header.edges; ++e) {
+        edgeIndex.insert(make_pair(edgeKey(nodes.handleAt(edge_records[e].from), nodes.handleAt(edge_records[e].to)),
+                                   (int) e));
+    }
+
+    mapped_snapshot.reset();
+}
+
+void Graph::removeEdge(NodeHandle handle1, NodeHandle handle2) {
+
+    // Edges are about to move
+    unmapSnapshot();
+
+    Node& node1 = getNode(handle1);
+    Node& node2 = getNode(handle2);
+
+    relations.removeBetween(node1.index, node2.index);
+
+    EdgeIndex::iterator it = edgeIndex.find(edgeKey(handle1, handle2));
+    if (it == edgeIndex.end()) return;
+
+    int e = it->second;
+    edgeIndex.erase(it);
+
+    adjacency.removeEdge(node1.index, node2.index, e);
+
+    // The last edge takes the index of the removed one
+    int last = edges.size() - 1;
+
+    if (e != last) {
+        const Edge& moved = edges[last];
+
+        adjacency.renameEdge(nodes.indexOf(moved.getNode1()), nodes.indexOf(moved.getNode2()), last, e);
+        edgeIndex[edgeKey(moved.getNode1(), moved.getNode2())] = e;
+
+        edges[e] = moved;
+    }
+
+    edges.pop_back();
+
+    stress_dirty = true;
+    topology_dirty = true;
+    wakeNode(node1.index);
+    wakeNode(node2.index);
+    resume();
+
+    // Nodes may now be farther from the selection
+    if (!selectedNodes.empty()) {
+        vector<int> ends;
+        ends.push_back(node1.index);
+        ends.push_back(node2.index);
+        updateDistancesAround(ends);
+    }
+}
+
+void Graph::removeNode(NodeHandle handle) {
+
+    Node* node = nodes.find(handle);
+    if (node == NULL) return;
+
+    TRACE("Removing node " << node->getID());
+
+    // Nodes and edges are about to move
+    unmapSnapshot();
+
+    if (node->selected) deselect(handle);
+
+    // Every relation has a reciprocal: removing the edges towards the
+    // targets of the outgoing relations removes all the relations.
+    const AdjacencyIndex& outgoing = relations.outgoing();
+    while (outgoing.degree(node->index) > 0)
+        removeEdge(handle, nodes.handleAt(outgoing.begin(node->index)->node));
+
+    ids.erase(hash_value(node->getID()));
+
+    pair<AliasKeys::iterator, AliasKeys::iterator> aliases = alias_keys.equal_range(handle.raw());
+    for (AliasKeys::iterator it = aliases.first; it != aliases.second; ++it)
+        ids.erase(it->second);
+    alias_keys.erase(aliases.first, aliases.second);
+
+    // Distances still pending in a batch refer to the current indices
+    propagateDistances();
+
+    // The last node takes the index of the removed one: every structure
+    // indexed by node follows.
+    int index = node->index;
+    int last = nodes.size() - 1;
+
+    int kept = 0;
+    for (size_t k = 0; k < activeNodes.size(); ++k) {
+        if (activeNodes[k] == index) continue;
+        activeNodes[kept++] = activeNodes[k] == last ? index : activeNodes[k];
+    }
+    activeNodes.resize(kept);
+
+    adjacency.removeNode(index);
+    relations.removeNode(index);
+    nodes.erase(handle);
+
+    if (index != last) nodes[index].index = index;
+
+    stress_dirty = true;
+    topology_dirty = true;
+    nodes_reindexed = true;
+    resume();
+}
+
+int Graph::enforceNodeBudget() {
+
+    if (NODE_BUDGET <= 0 || nodes.size() <= NODE_BUDGET) return 0;
+
+    // Evicting down to 90% of the budget: the nodes are not sorted again
+    // at each insertion.
+    int target = NODE_BUDGET - NODE_BUDGET / 10;
+
+    // Sorted by (in focus, last activity): nodes out of focus first, then
+    // the least recently used first.
+    vector<pair<pair<int, unsigned int>, NodeHandle> > candidates;
+
+    BOOST_FOREACH(const Node& node, nodes) {
+        if (node.selected) continue;
+
+        int focused = !selectedNodes.empty() && node.distance_to_selected < MAX_NODE_LEVELS;
+        candidates.push_back(make_pair(make_pair(focused, node.last_activity), node.handle));
+    }
+
+    int count = MIN((int) candidates.size(), nodes.size() - target);
+
+    nth_element(candidates.begin(), candidates.begin() + count, candidates.end());
+
+    TRACE("Node budget exceeded: removing " << count << " nodes");
+
+    Batch batch(*this);
+
+    for (int k = 0; k < count; ++k) {
+        removeNode(candidates[k].second);
+    }
+
+    int released = StringPool::collect();
+    TRACE(released << " strings released");
+
+    return count;
 }
 
 void Graph::updateDistances() {
 
-    // No node selected, set all distance to -1
     if (selectedNodes.empty()) {
-        // Renders nodes
-        BOOST_FOREACH(NodeMap::value_type& n, nodes) {
-            n.second.distance_to_selected = -1;
+        resetDistances(-1);
+        return;
+    }
+
+    resetDistances(distanceCap());
+
+    BOOST_FOREACH(NodeHandle node, selectedNodes) {
+        setDistance(nodes.indexOf(node), 0);
+    }
+
+    propagateDistances();
+}
+
+int Graph::distanceCap() {
+    return MAX(MAX_NODE_LEVELS, FOCUS_RADIUS);
+}
+
+void Graph::resetDistances(int distance) {
+    BOOST_FOREACH(Node& n, nodes) {
+        n.distance_to_selected = distance;
+        n.distance_to_selected_updated = false;
+    }
+}
+
+void Graph::setDistance(int index, int distance) {
+
+    Node& node = nodes[index];
+
+    // Only distances that are lowered (and under the cap) are propagated.
+    if (distance >= distanceCap() || distance >= node.distance_to_selected) return;
+
+    node.distance_to_selected = distance;
+    node.distance_to_selected_updated = true;
+
+    distance_buckets.resize(distanceCap());
+    distance_buckets[distance].push_back(index);
+}
+
+void Graph::propagateDistances() {
+
+    // Buckets are processed by increasing distance: a node is expanded
+    // once, from its final distance. Entries made stale by a later, lower
+    // distance are skipped.
+    for (size_t d = 0; d < distance_buckets.size(); ++d) {
+        for (size_t k = 0; k < distance_buckets[d].size(); ++k) {
+            int i = distance_buckets[d][k];
+            if (nodes[i].distance_to_selected != (int) d) continue;
+
+            for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+                setDistance(n->node, d + 1);
+            }
         }
+        distance_buckets[d].clear();
+    }
+}
 
-        return;
+void Graph::updateDistancesAround(const vector<int>& centres) {
+
+    int cap = distanceCap();
+
+    // Only the nodes closer than the cap to the deselected node (or to the
+    // ends of a removed edge) may have got their distance through it: they
+    // form the region that is recomputed.
+    distance_region.resize(nodes.size(), 0);
+
+    vector<int> region;
+
+    BOOST_FOREACH(int i, centres) {
+        if (distance_region[i]) continue;
+        distance_region[i] = 1;
+        region.push_back(i);
+    }
+
+    for (size_t k = 0, level_end = region.size(), level = 0; k < region.size(); ++k) {
+        if (k == level_end) {
+            level_end = region.size();
+            level++;
+        }
+        if (level + 1 >= (size_t) cap) continue;
+
+        int i = region[k];
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            if (distance_region[n->node]) continue;
+            distance_region[n->node] = 1;
+            region.push_back(n->node);
+        }
+    }
+
+    BOOST_FOREACH(int i, region) {
+        nodes[i].distance_to_selected = cap;
+        nodes[i].distance_to_selected_updated = false;
     }
-    //Else, start from the selected node
-    BOOST_FOREACH(NodeMap::value_type& n, nodes) {
-        n.second.distance_to_selected_updated = false;
+
+    // The region is then reached again from the selected nodes it contains,
+    // and from its border.
+    BOOST_FOREACH(int i, region) {
+        if (nodes[i].selected) setDistance(i, 0);
+
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            if (!distance_region[n->node])
+                setDistance(i, nodes[n->node].distance_to_selected + 1);
+        }
     }
 
-    BOOST_FOREACH(Node* node, selectedNodes) {
-        recurseUpdateDistances(node, NULL, 0);
+    BOOST_FOREACH(int i, region) {
+        distance_region[i] = 0;
     }
 
+    propagateDistances();
+}
+
+static void inconsistent(const string& what) {
+    throw OroViewException("Inconsistent graph: " + what);
 }
 
-void Graph::recurseUpdateDistances(Node* node, Node* parent, int distance) {
-    node->distance_to_selected = distance;
-    node->distance_to_selected_updated = true;
-    TRACE("Node " << node->getID() << " is at " << distance << " nodes from closest selected");
+static bool hasNeighbour(const AdjacencyIndex& index, int node, int neighbour, int edge) {
+
+    for (AdjacencyIndex::const_iterator n = index.begin(node); n != index.end(node); ++n) {
+        if (n->node == neighbour && n->edge == edge) return true;
+    }
+    return false;
+}
+
+void Graph::checkConsistency() const {
+
+    int count = nodes.size();
+    size_t alias_count = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const Node& node = nodes[i];
+
+        if (node.index != i)
+            inconsistent("node " + node.getID() + " has a wrong index");
+        if (nodes.indexOf(node.handle) != i)
+            inconsistent("the handle of node " + node.getID() + " is stale");
+        if (findKey(hash_value(node.getID())) != node.handle)
+            inconsistent("node " + node.getID() + " is not found by its ID");
+
+        pair<AliasKeys::const_iterator, AliasKeys::const_iterator> aliases = alias_keys.equal_range(node.handle.raw());
+        for (AliasKeys::const_iterator alias = aliases.first; alias != aliases.second; ++alias) {
+            if (findKey(alias->second) != node.handle)
+                inconsistent("an alias of node " + node.getID() + " is not found");
+            alias_count++;
+        }
+    }
+
+    if (alias_count != alias_keys.size())
+        inconsistent("aliases refer to removed nodes");
+
+    // Without a mapped snapshot, every key and edge is in the maps
+    if (!mapped_snapshot) {
+        if (ids.size() != nodes.size() + alias_keys.size())
+            inconsistent("the ID index has stale keys");
+        if (edgeIndex.size() != edges.size())
+            inconsistent("the edge index has stale edges");
+    }
+
+    if (adjacency.nodesCount() != count)
+        inconsistent("the adjacency index has a wrong amount of rows");
+
+    int degrees = 0;
+    for (int i = 0; i < count; ++i) degrees += adjacency.degree(i);
+    if (degrees != 2 * (int) edges.size())
+        inconsistent("the adjacency index has stale entries");
+
+    for (size_t e = 0; e < edges.size(); ++e) {
+        NodeHandle handle1 = edges[e].getNode1();
+        NodeHandle handle2 = edges[e].getNode2();
+        int node1 = nodes.indexOf(handle1);
+        int node2 = nodes.indexOf(handle2);
+
+        if (node1 < 0 || node2 < 0)
+            inconsistent("an edge refers to a removed node");
+
+        const string& id1 = nodes[node1].getID();
+        const string& id2 = nodes[node2].getID();
+
+        if (findEdge(handle1, handle2) != (int) e)
+            inconsistent("the edge " + id1 + " - " + id2 + " is not indexed");
+        if (!hasNeighbour(adjacency, node1, node2, e) || !hasNeighbour(adjacency, node2, node1, e))
+            inconsistent("the edge " + id1 + " - " + id2 + " is not in the adjacency index");
+    }
+
+    const AdjacencyIndex& outgoing = relations.outgoing();
+    const AdjacencyIndex& incoming = relations.incoming();
+
+    if (outgoing.nodesCount() != count || incoming.nodesCount() != count)
+        inconsistent("the relation indices have a wrong amount of rows");
+
+    int outgoing_degrees = 0, incoming_degrees = 0;
+    for (int i = 0; i < count; ++i) {
+        outgoing_degrees += outgoing.degree(i);
+        incoming_degrees += incoming.degree(i);
+    }
+    if (outgoing_degrees != relations.size() || incoming_degrees != relations.size())
+        inconsistent("the relation indices have stale entries");
+
+    for (int r = 0; r < relations.size(); ++r) {
+        int from = relations.from(r);
+        int to = relations.to(r);
+
+        if (from < 0 || from >= count || to < 0 || to >= count)
+            inconsistent("a relation refers to a removed node");
+
+        const string& from_id = nodes[from].getID();
+        const string& to_id = nodes[to].getID();
+
+        if (!hasNeighbour(outgoing, from, to, r) || !hasNeighbour(incoming, to, from, r))
+            inconsistent("the relation " + from_id + " -> " + to_id + " is not indexed");
+        if (relations.find(to, from) < 0)
+            inconsistent("the relation " + from_id + " -> " + to_id + " has no reciprocal");
+        if (from != to && !hasEdgeBetween(nodes.handleAt(from), nodes.handleAt(to)))
+            inconsistent("the relation " + from_id + " -> " + to_id + " has no edge");
+    }
+
+    BOOST_FOREACH(int i, activeNodes) {
+        if (i < 0 || i >= count)
+            inconsistent("an active node has been removed");
+    }
+
+    BOOST_FOREACH(NodeHandle node, selectedNodes) {
+        if (!nodes.contains(node))
+            inconsistent("a selected node has been removed");
+    }
+
+    // Full breadth-first search from the selection, capped like updateDistances()
+    int cap = distanceCap();
+    vector<int> distances(count, selectedNodes.empty() ? -1 : cap);
+    vector<int> queue;
+
+    BOOST_FOREACH(NodeHandle node, selectedNodes) {
+        int i = nodes.indexOf(node);
+        distances[i] = 0;
+        queue.push_back(i);
+    }
+
+    for (size_t k = 0; k < queue.size(); ++k) {
+        int i = queue[k];
+        if (distances[i] + 1 >= cap) continue;
+
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            if (distances[n->node] <= distances[i] + 1) continue;
+            distances[n->node] = distances[i] + 1;
+            queue.push_back(n->node);
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const Node& node = nodes[i];
+        bool reached = distances[i] >= 0 && distances[i] < cap;
 
-    BOOST_FOREACH(Node* n, node->getConnectedNodes()){
-        if (n != parent &&
-            (!n->distance_to_selected_updated || distance < n->distance_to_selected))
-                recurseUpdateDistances(n, node, distance + 1);
+        if (node.distance_to_selected != distances[i] || node.distance_to_selected_updated != reached)
+            inconsistent("node " + node.getID() + " has a wrong distance to the selection");
     }
 }
 
@@ -258,130 +1770,160 @@ int Graph::edgesCount() {
     return edges.size();
 }
 
-vec2f Graph::coulombRepulsionFor(const Node& node) const {
+void Graph::memoryUsage(MemoryUsage& usage) const {
 
-    vec2f force(0.0, 0.0);
+    usage.add("nodes", nodes.memoryUsage() + hashTableBytes(ids) + hashTableBytes(alias_keys));
 
-    //TODO: a simple optimization can be to compute Coulomb force
-    //at the same time than Hooke force when possible -> one
-    // less distance computation (not sure it makes a big difference)
+    usage.add("edges", capacityBytes(edges) + hashTableBytes(edgeIndex) + adjacency.memoryUsage());
 
-    BOOST_FOREACH(const NodeMap::value_type& nm, nodes) {
-        const Node& n = nm.second;
-        if (&n != &node) {
-            vec2f delta = n.pos - node.pos;
+    usage.add("relations", relations.memoryUsage());
 
-            //Coulomb repulsion force is in 1/r^2
-            float len = delta.length2();
-            if (len < 0.01) len = 0.01; //avoid dividing by zero
+    usage.add("strings", StringPool::memoryUsage());
 
-            float f = COULOMB_CONSTANT * n.charge * node.charge / len;
+    size_t splines = 0;
+    BOOST_FOREACH(const Edge& edge, edges) {
+        splines += edge.rendererMemoryUsage();
+    }
+    usage.add("edge renderers", splines);
 
-            force += project(f, delta);
-        }
+    size_t distances = capacityBytes(distance_buckets) + capacityBytes(distance_region);
+    BOOST_FOREACH(const vector<int>& bucket, distance_buckets) {
+        distances += capacityBytes(bucket);
     }
 
-    return force;
+    usage.add("physics", physics.memoryUsage() + capacityBytes(activeNodes) +
+                         capacityBytes(steppedNodes) + capacityBytes(steppedSelected) +
+                         capacityBytes(stepped_marks) + distances +
+                         repulsionTree.memoryUsage() + repulsionGrid.memoryUsage() +
+                         stressLayout.memoryUsage() + capacityBytes(stress_positions));
 
+    const GraphSnapshot* snapshot = snapshots.latest();
+    usage.add("snapshots", snapshot == NULL ? 0 : snapshot->memoryUsage());
+
+    usage.count("nodes", nodes.size());
+    usage.count("edges", edges.size());
+    usage.count("relations", relations.size());
+    usage.count("strings", StringPool::size());
 }
 
-vec2f Graph::coulombRepulsionAt(const vec2f& pos) const {
+void Graph::physicsBounds(vec2f& min, vec2f& max) const {
 
-    vec2f force(0.0, 0.0);
+    min = max = vec2f(physics.x[0], physics.y[0]);
 
-    //TODO: a simple optimization can be to compute Coulomb force
-    //at the same time than Hooke force when possible -> one
-    // less distance computation (not sure it makes a big difference)
+    for (int i = 0; i < physics.size(); ++i) {
+        min.x = MIN(min.x, physics.x[i]); min.y = MIN(min.y, physics.y[i]);
+        max.x = MAX(max.x, physics.x[i]); max.y = MAX(max.y, physics.y[i]);
+    }
+}
 
-    BOOST_FOREACH(const NodeMap::value_type& nm, nodes) {
-        const Node& n = nm.second;
+void Graph::updateRepulsionTree() {
 
-        vec2f delta = n.pos - pos;
+    if (nodes.empty()) return;
 
-        //Coulomb repulsion force is in 1/r^2
-        float len = delta.length2();
-        if (len < 0.01) len = 0.01; //avoid dividing by zero
+    // Built from the physics store, ie the positions at the beginning of the step.
+    vec2f min, max;
+    physicsBounds(min, max);
 
-        float f = COULOMB_CONSTANT * n.charge * INITIAL_CHARGE / len;
+    repulsionTree.setTheta(BARNES_HUT_THETA);
+    repulsionTree.reset(min, max, sources.params.coulomb_constant);
 
-        force += project(f, delta);
+    for (int i = 0; i < physics.size(); ++i) {
+        repulsionTree.insert(i, vec2f(physics.x[i], physics.y[i]), physics.charge[i]);
     }
 
-    return force;
+    repulsionTree.computeCharges();
+}
+
+void Graph::updateRepulsionGrid() {
+
+    if (nodes.empty()) return;
+
+    vec2f min, max;
+    physicsBounds(min, max);
 
+    repulsionGrid.reset(min, max, GRID_CUTOFF, sources.params.coulomb_constant);
+
+    for (int i = 0; i < physics.size(); ++i) {
+        repulsionGrid.insert(i, vec2f(physics.x[i], physics.y[i]), physics.charge[i]);
+    }
+
+    repulsionGrid.computeCells();
 }
 
-vec2f Graph::hookeAttractionFor(const Node& node) const {
+vec2f Graph::coulombRepulsionFor(const Node& node) const {
 
-    vec2f force(0.0, 0.0);
+    if (REPULSION_ENGINE == BARNES_HUT_ENGINE)
+        return repulsionTree.repulsionAt(node.pos, node.charge, node.index);
+
+    if (REPULSION_ENGINE == GRID_ENGINE)
+        return repulsionGrid.repulsionAt(node.pos, node.charge, node.index);
+
+    return exactCoulombRepulsionFor(node);
+}
 
-    //TODO: a simple optimization can be to compute Coulomb force
-    //at the same time than Hooke force when possible -> one
-    // less distance computation (not sure it makes a big difference)
+vec2f Graph::coulombRepulsionAt(const vec2f& pos) const {
 
-    BOOST_FOREACH(const Edge* e, getEdgesFor(node)) {
-        const Node& n_tmp = getConstNode(e->getId1());
+    if (REPULSION_ENGINE == BARNES_HUT_ENGINE)
+        return repulsionTree.repulsionAt(pos, INITIAL_CHARGE);
 
-        //Retrieve the node at the edge other extremity
-        const Node& n2 = ( (&n_tmp != &node) ? n_tmp : getConstNode(e->getId2()) );
+    if (REPULSION_ENGINE == GRID_ENGINE)
+        return repulsionGrid.repulsionAt(pos, INITIAL_CHARGE);
 
-        TRACE("\tComputing Hooke force from " << node.getID() << " to " << n2.getID());
+    return exactCoulombRepulsionAt(pos);
+}
 
-        vec2f delta = n2.pos - node.pos;
+vec2f Graph::exactCoulombRepulsionFor(const Node& node) const {
 
-        float f = - e->spring_constant * (e->length - e->nominal_length);
+    vec2f force(0.0, 0.0);
 
-        force += project(f, delta);
+    BOOST_FOREACH(const Node& other, nodes) {
+        if (&other == &node) continue;
+        force += coulomb(other.pos - node.pos, other.charge * node.charge);
     }
 
-    return force;
+    return force * COULOMB_CONSTANT;
 }
 
-vec2f Graph::gravityFor(const Node& node) const {
-    //Gravity... well, it's actually more like anti-gravity, since it's in:
-    // f = g * m * d
+vec2f Graph::exactCoulombRepulsionAt(const vec2f& pos) const {
+
     vec2f force(0.0, 0.0);
 
-    float len = node.pos.length2();
+    BOOST_FOREACH(const Node& other, nodes) {
+        force += coulomb(other.pos - pos, other.charge * INITIAL_CHARGE);
+    }
 
-    if (len < 0.01) len = 0.01; //avoid dividing by zero
+    return force * COULOMB_CONSTANT;
+}
 
-    float f = GRAVITY_CONSTANT * node.mass * len * 0.01;
+vec2f Graph::hookeAttractionFor(const Node& node) const {
 
-    force += project(f, node.pos);
+    vec2f force(0.0, 0.0);
 
-    return force;
-}
+    for (AdjacencyIndex::const_iterator n = adjacency.begin(node.index);
+         n != adjacency.end(node.index); ++n) {
 
-vec2f Graph::project(float force, const vec2f& d) const {
-    //we need to project this force on x and y
-    //-> Fx = F.cos(arctan(Dy/Dx)) = F/sqrt(1-(Dy/Dx)^2)
-    //-> Fy = F.sin(arctan(Dy/Dx)) = F.(Dy/Dx)/sqrt(1-(Dy/Dx)^2)
-    vec2f res(0.0, 0.0);
+        const Edge& e = edges[n->edge];
 
-    TRACE("\tForce: " << force << " - Delta: (" << d.x << ", " << d.y << ")");
+        vec2f delta = nodes[n->node].pos - node.pos;
+        float length = delta.length();
 
-    if (d.y == 0.0) {
-        res.x = force;
-        return res;
+        force += delta * (HookeAttraction::force(e.spring_constant, length, e.nominal_length) / MAX(length, MIN_SPRING_LENGTH));
     }
 
-    if (d.x == 0.0) {
-        res.y = force;
-        return res;
-    }
+    return force;
+}
 
-    float dydx = d.y/d.x;
-    float sqdydx = 1/sqrt(1 + dydx * dydx);
+vec2f Graph::gravityFor(const Node& node) const {
+    //Gravity... well, it's actually more like anti-gravity, since it's in:
+    // f = g * m * d
+    float len = node.pos.length2();
 
-    res.x = force * sqdydx;
-    if (d.x > 0.0) res.x = - res.x;
-    res.y = force * sqdydx * abs(dydx);
-    if (d.y > 0.0) res.y = - res.y;
+    // A node exactly at the centre stays there
+    if (len == 0.0) return vec2f(0.0, 0.0);
 
-    TRACE("\t-> After projection: Fx=" << res.x << ", Fy=" << res.y);
+    float f = GRAVITY_CONSTANT * node.mass * MAX(len, 0.01) * 0.01;
 
-    return res;
+    return node.pos * (- f / sqrt(len));
 }
 
 void Graph::saveToGraphViz(OroView& env) {
@@ -390,12 +1932,12 @@ void Graph::saveToGraphViz(OroView& env) {
 
     // Renders edges
     BOOST_FOREACH(Edge& e, edges) {
-        e.render(GRAPHVIZ, env);
+        e.render(GRAPHVIZ, env, *this);
     }
 
     // Renders nodes
-    BOOST_FOREACH(NodeMap::value_type& n, nodes) {
-        n.second.render(GRAPHVIZ, env, false);
+    BOOST_FOREACH(Node& n, nodes) {
+        n.render(GRAPHVIZ, env);
     }
 
     env.graphvizGraph << "}\n";
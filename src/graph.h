@@ -18,82 +18,579 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
-#include <map>
+#include <unordered_map>
 #include <vector>
 #include <set>
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "oroview_exceptions.h"
 
+#include "slot_map.h"
 #include "node.h"
 #include "edge.h"
 #include "node_relation.h"
+#include "relation_table.h"
+#include "barnes_hut.h"
+#include "uniform_grid.h"
+#include "worker_pool.h"
+#include "physics_store.h"
+#include "physics_kernels.h"
+#include "force_model.h"
+#include "adjacency.h"
+#include "stress_layout.h"
+#include "random_generator.h"
+#include "layout_cache.h"
+#include "snapshot.h"
+#include "graph_snapshot.h"
+#include "memory_usage.h"
 
 class OroView;
+class SnapshotFile;
 
 class Graph
 {
 public:
     /**
-      a map of nodes. The key is the node ID.
+      The nodes, stored contiguously and referred to by handles. Their dense
+      index (Node::index) is their insertion rank: everything that influences
+      the layout iterates over the nodes in this order. Allows as well to
+      split the nodes between the physics workers.
      */
-    typedef std::map<int, Node> NodeMap;
+    typedef SlotMap<Node> NodeSlots;
 
     /**
-      map of all nodes + aliases.
+      Handles of all nodes + aliases. The key is the hash value of the ID.
       */
-    typedef std::map<int, Node*> AliasMap;
+    typedef std::unordered_map<int, NodeHandle> IdIndex;
 
 private:
 
-    NodeMap nodes;
-    AliasMap aliases;
+    NodeSlots nodes;
+    IdIndex ids;
+
+    /**
+      Keys of the aliases in 'ids', by node handle (raw value), to remove
+      them with the node.
+      */
+    typedef std::unordered_multimap<uint32_t, int> AliasKeys;
+    AliasKeys alias_keys;
+
+    /**
+      Incremented each time a node is added, selected or woken up from
+      outside: gives the order in which nodes were last used (cf
+      Node::last_activity).
+      */
+    unsigned int activity_clock;
+    void touch(Node& node);
 
     typedef std::vector<Edge> EdgeVector;
     EdgeVector edges;
 
     /**
-      Stores pointers to the currently selected nodes
+      Index of each edge in 'edges', keyed by the unordered pair of the
+      handles of its nodes (cf edgeKey()). There is at most one edge between
+      two nodes.
+      */
+    typedef std::unordered_map<uint64_t, int> EdgeIndex;
+    EdgeIndex edgeIndex;
+
+    static uint64_t edgeKey(NodeHandle node1, NodeHandle node2);
+
+    /**
+      Snapshot the graph was loaded from (cf loadSnapshot()), if any: its ID
+      and edge hash tables are used in place of 'ids' and 'edgeIndex' for the
+      loaded nodes and edges, which then only hold the nodes and edges added
+      since. Valid as long as the nodes and edges keep the indices they have
+      in the file, ie until the first removal (cf unmapSnapshot()).
+      */
+    boost::shared_ptr<SnapshotFile> mapped_snapshot;
+
+    /**
+      Copies the hash tables of the mapped snapshot to 'ids' and
+      'edgeIndex', and releases it. Called before nodes or edges are
+      removed.
+      */
+    void unmapSnapshot();
+
+    /**
+      Handle of the node of an ID (or alias) key, null if there is none.
+      */
+    NodeHandle findKey(int key) const;
+
+    /**
+      Index of the edge between two nodes, -1 if there is none.
+      */
+    int findEdge(NodeHandle node1, NodeHandle node2) const;
+
+    /**
+      For each node (by index), its neighbours and the edges leading to them.
+      */
+    AdjacencyIndex adjacency;
+
+    /**
+      The relations between the nodes (several relations may share one edge).
+      */
+    RelationTable relations;
+
+    /**
+      Stores the handles of the currently selected nodes
       */
-    std::set<Node*> selectedNodes;
+    std::set<NodeHandle> selectedNodes;
+
+    /**
+      Quadtree used to approximate the Coulomb repulsion when the
+      Barnes-Hut engine is active. Rebuilt at each step.
+      */
+    BarnesHutTree repulsionTree;
+    void updateRepulsionTree();
+
+    /**
+      Spatial hash used to compute the short-range repulsion when the grid
+      engine is active. Rebuilt at each step.
+      */
+    UniformGrid repulsionGrid;
+    void updateRepulsionGrid();
+
+    // Bounding box of the nodes in the physics store
+    void physicsBounds(vec2f& min, vec2f& max) const;
+
+    /**
+      Threads used to run the physics step.
+      */
+    WorkerPool workers;
+
+    /**
+      Packed physical state of the nodes, by dense index.
+      */
+    PhysicsStore physics;
+    const PhysicsKernels* kernels;
+
+    /**
+      Indices of the nodes that are awake. Only those are simulated: the
+      state of sleeping nodes stays untouched in the physics store.
+      */
+    std::vector<int> activeNodes;
+
+    void wakeNode(int index);
+    void updateActiveNodes(float dt);
+
+    /**
+      Convergence of the whole simulation: kinetic energy of the active
+      nodes, and largest displacement of a node, at the last step. Once both
+      have stayed under REST_ENERGY (per node) and REST_DISPLACEMENT for
+      REST_DELAY seconds, the graph is at rest and is not stepped anymore.
+
+      With the stress solver, the graph is still once an iteration lowers
+      the stress by less than STRESS_TOLERANCE (the sparse model keeps
+      drifting by a fraction of a pixel long after it has converged), or
+      moves no node by more than REST_DISPLACEMENT.
+      */
+    float total_energy;
+    float max_displacement;
+    float rest_time;
+    std::atomic<bool> at_rest;
+
+    // Some node still decays, or its label fades out (cf isFading()).
+    // Only used from the rendering thread.
+    bool decaying;
+    bool fading;
+
+    void updateConvergence(float dt);
+    void updateRest(float dt, bool still);
+
+    /**
+      Level of detail of the physics. When nodes are selected, only the
+      active nodes closer than FOCUS_RADIUS to the selection are stepped at
+      every tick. The other ones are stepped in turn every LOD_DECIMATION
+      ticks (with a time step LOD_DECIMATION times longer), or frozen if
+      LOD_DECIMATION is 0. Their repulsion is a coarse Barnes-Hut aggregate
+      (opening angle LOD_THETA).
+      */
+    bool lod_active;
+    int lod_tick;
+
+    /**
+      Active nodes stepped at this tick, by increasing index: first the
+      focused_count nodes in focus, then the ones out of focus. Runs of
+      consecutive indices are integrated at once, by the SIMD kernels.
+      */
+    std::vector<int> steppedNodes;
+    int focused_count;
+
+    // Selected nodes among the stepped ones
+    std::vector<int> steppedSelected;
+
+    // Per node (by index): 1 if stepped in focus, 2 if stepped out of focus
+    std::vector<char> stepped_marks;
+
+    void selectSteppedNodes();
+
+    /**
+      Distances to the selection (Node::distance_to_selected) are computed by
+      a multi-source breadth-first search, with one bucket of nodes per
+      distance. They are patched locally: adding a node, an edge or a
+      selected node only lowers the distances of the nodes around it, and
+      deselecting a node only recomputes the distances of the nodes closer
+      than distanceCap() to it.
+      */
+    std::vector<std::vector<int> > distance_buckets;
+    std::vector<char> distance_region;
+
+    /**
+      Nesting depth of the current batch (cf beginBatch()), and amount of
+      edges added since the outermost batch began.
+      */
+    int batch_depth;
+    int batch_edges;
+
+    void setDistance(int index, int distance);
+    void propagateDistances();
+    void resetDistances(int distance);
+    void updateDistancesAround(const std::vector<int>& centres);
+    bool inFocus(const Node& node) const;
+    float stepTimeFor(const Node& node, float dt) const;
+
+    /**
+      Sparse stress majorization, used instead of the forces when
+      LAYOUT_SOLVER is STRESS_SOLVER. Its terms are recomputed at the next
+      step whenever nodes or edges are added. Until the nodes have been
+      placed once (by computeInitialLayout() or applyLayout()), the first
+      step places them with a pivot MDS.
+      */
+    StressLayout stressLayout;
+    bool stress_dirty;
+    bool stress_initialised;
+    std::vector<vec2f> stress_positions;
+
+    void stepStress(float dt);
+
+    /**
+      Constants of the force model, and repulsion engines, for the current
+      step.
+      */
+    RepulsionSources sources;
+
+    void loadNodes(int begin, int end);
+
+    /**
+      Repulsion and spring forces of the stepped nodes [begin, end). One
+      instance per repulsion engine: the engine is chosen once per step.
+      Nodes out of focus always use CoarseRepulsion.
+      */
+    template <class Repulsion, class Attraction>
+    void forcePass(int begin, int end);
+
+    template <class Repulsion, class Attraction>
+    void applyForces(int begin, int end);
+
+    /**
+      Selected nodes are not pulled by their edges, but attracted towards
+      the centre: a separate pass, over the few selected nodes only, that
+      keeps this test out of the loops above.
+      */
+    void applyGravity();
+
+    void integrateNodes(int begin, int end, float dt);
+    void commitNodes(int begin, int end);
+
+    /**
+      Protects the graph when the physics runs in its own thread.
+      */
+    boost::mutex graph_mutex;
+
+    /**
+      Source of every random number used by the graph. For a given seed,
+      the same sequence of insertions gives bit-identical layouts.
+      */
+    RandomGenerator rng;
+
+    /**
+      Views of the graph published for the rendering and the picking, which
+      read them without locking (cf SnapshotChannel).
+      */
+    mutable SnapshotChannel<GraphSnapshot> snapshots;
+
+    /**
+      Whether nodes or edges have been added or removed since the last
+      publication, and whether nodes have been removed (which changes the
+      indices of the others).
+      */
+    bool topology_dirty;
+    bool nodes_reindexed;
+
+    void publish(bool stepped);
+
+    /**
+      Key of the graph among the holders of symbols (cf
+      StringPool::collect()): the strings of the removed nodes and edges
+      are released once no other graph uses them.
+      */
+    int string_holder;
+    void markSymbols(std::vector<bool>& marks) const;
+
+    vec2f exactCoulombRepulsionFor(const Node& node) const;
+    vec2f exactCoulombRepulsionAt(const vec2f& pos) const;
 
 public:
     Graph();
+    ~Graph();
 
+    /**
+      Runs one step of the physics simulation.
+
+      The physical state of the nodes is first copied to a packed physics
+      store, on which the forces are computed and integrated (with SIMD
+      kernels, if available and USE_SIMD is true). The step is split across
+      PHYSICS_THREADS threads. During the step, forces are computed from the
+      positions of the nodes at the end of the previous step only, while new
+      positions are written in a separate buffer. Positions are copied back to
+      the nodes once every node has been processed: the result does not
+      depend on the amount of threads.
+
+      The forces are computed by a pass specialised at compile time for each
+      repulsion engine (cf force_model.h), picked once per step. Selected
+      nodes get their gravity in a separate pass, and runs of consecutive
+      nodes are integrated at once by the SIMD kernels.
+
+      Only the nodes that are awake are simulated. A node falls asleep when
+      its kinetic energy has stayed below SLEEP_ENERGY for SLEEP_DELAY
+      seconds. Sleeping nodes still repulse the other nodes.
+
+      Once the whole graph is at rest (cf isAtRest()), the step does nothing
+      until the graph is modified.
+
+      When nodes are selected, nodes far from the selection are simulated at
+      a lower rate, or not at all (cf FOCUS_RADIUS and LOD_DECIMATION).
+
+      If LAYOUT_SOLVER is STRESS_SOLVER, forces are not simulated at all:
+      each step is one iteration of sparse stress majorization (cf
+      StressLayout) over all the nodes.
+
+      The step does not touch anything related to rendering: it can run in a
+      separate thread (cf PhysicsThread), as long as the graph mutex is held.
+      */
     void step(float dt);
 
+    /**
+      Places all the nodes with a multilevel layout (cf MultilevelLayout), or
+      the pivot MDS of the stress solver, instead of their current positions. Meant to be used once a large graph
+      has been loaded, to make it readable right away.
+      */
+    void computeInitialLayout();
+
+    /**
+      Stores the current position of every node in the cache.
+      */
+    void storeLayout(LayoutCache& cache) const;
+
+    /**
+      Places the nodes found in the cache (typically computed offline by
+      oroview-layout) at their cached position. Nodes missing from the cache
+      are placed next to a neighbour that is in it, if any.
+
+      Cached nodes start asleep: only the nodes missing from the cache and
+      their neighbours are simulated.
+
+      Returns the amount of nodes found in the cache.
+      */
+    int applyLayout(const LayoutCache& cache);
+
+    /**
+      Saves the whole graph (nodes, edges, relations, aliases and current
+      positions) to a binary snapshot (cf SnapshotFile). Throws an
+      OroViewException if the file can not be written.
+      */
+    void saveSnapshot(const std::string& path) const;
+
+    /**
+      Loads a snapshot written by saveSnapshot() into this graph, which must
+      be empty. The file is mapped in memory and its tables are read in place:
+      the strings stay in the file until they are looked up (cf
+      StringPool::addTable()), and its hash tables are used for the IDs and
+      edges (cf mapped_snapshot). Nodes start asleep, at their saved position.
+
+      Returns false if the file does not exist or is not a valid snapshot.
+      */
+    bool loadSnapshot(const std::string& path);
+
+    /**
+      Mutex to hold while stepping or modifying the graph (adding nodes or
+      edges, selecting, tickling, moving nodes...) when the physics runs in
+      its own thread. Rendering does not need it.
+      */
+    boost::mutex& getMutex();
+
+    /**
+      Publishes a snapshot of the graph with the current positions of the
+      nodes, to be used for rendering and picking. To be called after each
+      step, with the graph mutex held.
+      */
+    void publishPositions();
+
+    /**
+      Publishes a snapshot of the graph if nodes or edges have been added or
+      removed since the last one, so that they can be picked before the next
+      physics step. The published positions are left as they are. To be called
+      with the graph mutex held.
+      */
+    void publishTopology();
+
+    /**
+      Sets the rendering position of every node, interpolated between the two
+      last published positions: alpha = 0 means the positions published by
+      the previous step, alpha = 1 the last ones. Reads the latest snapshot:
+      does not need the graph mutex.
+      */
+    void interpolate(float alpha);
+
+    /**
+      Updates the decay of the nodes (which modifies their charge). Needs the
+      graph mutex.
+      */
+    void decay(float dt);
+
+    /**
+      Updates the renderers of the nodes and edges. Relies on the OpenGL
+      state: must be called from the rendering thread.
+      */
+    void updateRenderers(float dt);
+
+    /**
+      Wakes up a node and its neighbours. Must be called whenever a node is
+      moved or its charge is changed from outside of the graph (dragged,
+      tickled...). Selection and insertion of nodes or edges wake the nodes
+      automatically.
+      */
+    void wake(Node& node);
+
+    int activeNodesCount() const;
+
+    /**
+      Amount of nodes stepped at the last tick: the active nodes, minus the
+      out of focus ones skipped by the level of detail.
+      */
+    int steppedNodesCount() const;
+
+    /**
+      Resumes the simulation if the graph was at rest. Called whenever nodes
+      or edges are added, and by wake().
+      */
+    void resume();
+
+    /**
+      True when the simulation has converged, and is suspended. Can be called
+      without holding the graph mutex.
+      */
+    bool isAtRest() const;
+
+    /**
+      True when nodes still change on screen while the graph is at rest: a
+      node decays after having been tickled, or the label of a node fades
+      out (cf FADE_TIME). Updated by decay() and updateRenderers().
+      */
+    bool isFading() const;
+
+    /**
+      Total kinetic energy of the active nodes at the last step.
+      */
+    float totalEnergy() const;
+
+    /**
+      Largest displacement of a node (in pixels) at the last step.
+      */
+    float maxDisplacement() const;
+
+    /**
+      Normalised stress of the layout at the last step, when the stress
+      solver is used (0 means every distance is ideal).
+      */
+    float stress() const;
+
+    /**
+      Name of the physics kernels used at the last step ("scalar", "SSE"...)
+      */
+    const char* kernelsName() const;
+
+    int threadsCount() const;
+
     /**
       Renders the graph. If called with argument 'false', goes in simple mode.
 
       In simple mode, neither edges or special effects are rendered. Useful for picking selected
       primitive in OpenGL GL_SELECT mode.
       */
-    void render(rendering_mode mode, OroView& env, bool debug = false);
+    void render(rendering_mode mode, OroView& env);
+
+    /**
+      Draws the forces applied to each node at the last physics step (debug
+      overlay). Needs the graph mutex.
+      */
+    void renderForces() const;
 
     /**
       Returns an immutable reference to the list of nodes.
       */
-    const NodeMap& getNodes() const;
+    const NodeSlots& getNodes() const;
+
+    /**
+      Returns an immutable reference to the relations between the nodes.
+      */
+    const RelationTable& getRelations() const;
 
     /**
       Returns a reference to a node by its id. Throws an exception if the node doesn't exist.
+
+      Like any reference to a node, it is only valid until the next node is
+      added: keep the handle of the node (Node::handle) instead.
       */
     Node& getNode(const std::string& id);
 
     const Node& getConstNode(const std::string& id) const;
 
     /**
-      Returns a pointer to a node by its tagid, ie the hash value of its ID. Return a NULL pointer
-      if the node doesn't exists.
+      Returns a reference to a node by its handle. Throws an exception if the
+      node doesn't exist.
+      */
+    Node& getNode(NodeHandle node);
+    const Node& getNode(NodeHandle node) const;
+
+    /**
+      Returns a pointer to a node by its handle, or a NULL pointer if the node
+      doesn't exist (anymore).
+      */
+    Node* findNode(NodeHandle node);
+
+    /**
+      Returns the handle of a node by its id (or one of its aliases). Returns a
+      null handle if the node doesn't exist.
       */
-    Node* getNodeByTagID(int tagid);
+    NodeHandle findHandle(const std::string& id) const;
 
     /**
-      Returns a random node.
+      Returns the handle of a node by its tagid, ie the hash value of its ID. Returns a null
+      handle if the node doesn't exists. Looks the tag up in the latest published
+      snapshot: does not need the graph mutex, but ignores the nodes added since.
+      */
+    NodeHandle getNodeByTagID(int tagid) const;
+
+    /**
+      Returns a random node, drawn from the graph random generator.
       */
     Node& getRandomNode();
 
-    void select(Node* node);
-    void deselect(Node* node);
+    /**
+      Restarts the random generator of the graph from the given seed.
+      */
+    void seed(unsigned int seed);
+
+    RandomGenerator& random();
+
+    void select(NodeHandle node);
+    void deselect(NodeHandle node);
     void clearSelect();
 
     /** If and only if ONE node is selected, return it. Else, returns NULL
@@ -103,33 +600,146 @@ public:
     void addAlias(const std::string& alias, const std::string& id);
 
     /**
-      Adds a new node to the graph (if it doesn't exist yet) and returns a reference to the new node.
+      Begins a batch of modifications (typically, many insertions). Until the
+      matching commit(), the distances to the selection are not propagated
+      after each new edge, but once, by commit(), which as well compacts the
+      adjacency of the nodes. Batches can be nested: only the outermost
+      commit() does the work.
+
+      Meant to be used through Graph::Batch.
+      */
+    void beginBatch();
+    void commit();
+
+    /**
+      Batch of modifications that lasts as long as this object:
+
+        {
+            Graph::Batch batch(graph);
+            // many addNode(), addEdge()...
+        }
+      */
+    class Batch : boost::noncopyable
+    {
+        Graph& graph;
+
+    public:
+        explicit Batch(Graph& graph) : graph(graph) {graph.beginBatch();}
+        ~Batch() {graph.commit();}
+    };
+
+    /**
+      Adds a new node to the graph (if it doesn't exist yet) and returns the handle of the node.
       */
-    Node& addNode(const std::string& id, const std::string& label, const Node* neighbour = NULL, node_type type = CLASS_NODE);
+    NodeHandle addNode(const std::string& id, const std::string& label, NodeHandle neighbour = NodeHandle(), node_type type = CLASS_NODE);
 
     /**
-      Adds a new edge to the graph (if it doesn't exist yet) between rel.from and rel.to
-      Returns a reference to the new edge.
+      Adds a relation from 'from' to 'to', and a new edge to the graph between
+      them if it doesn't exist yet.
+      */
+    void addEdge(NodeHandle from, NodeHandle to, const relation_type type, const std::string& label);
 
-      It stores as well in the Edge object the reference to the relation.
+    /**
+      Adds a node (if it doesn't exist yet) connected to the node 'to' (created
+      as well if needed), guessing the type of the node from the type of the
+      relation.
+
+      @return true if the node has been added, false else (can be false for nodes
+      without label if only_labelled_nodes is true)
       */
-    void addEdge(Node& from, Node& to, const relation_type type, const std::string& label);
+    bool addNodeConnectedTo(const std::string& id,
+                            const std::string& node_label,
+                            const std::string& to,
+                            relation_type type,
+                            const std::string& edge_label,
+                            bool only_labelled_nodes = false);
 
     std::vector<const Edge*> getEdgesFor(const Node& node) const;
-    std::vector<Edge*> getEdgesBetween(const Node& node1, const Node& node2);
+
+    /**
+      Range of the edges between two nodes (empty, or one edge), usable with
+      BOOST_FOREACH. Found in O(1), without any allocation. Valid until the
+      next edge is added.
+      */
+    typedef std::pair<Edge*, Edge*> EdgeRange;
+    EdgeRange getEdgesBetween(const Node& node1, const Node& node2);
+
+    bool hasEdgeBetween(NodeHandle node1, NodeHandle node2) const;
+
+    /**
+      Removes a node, its aliases, its edges and the relations that link to
+      it. The handle of the node becomes invalid, and the last node takes
+      its dense index.
+      */
+    void removeNode(NodeHandle node);
+
+    /**
+      Removes the edge between two nodes, and their relations to each other.
+      */
+    void removeEdge(NodeHandle node1, NodeHandle node2);
+
+    /**
+      If there are more than NODE_BUDGET nodes, removes the least recently
+      used ones (cf Node::last_activity) until 90% of the budget is left.
+      Nodes out of focus (farther than MAX_NODE_LEVELS from the selection)
+      go first. Selected nodes are never removed. The strings that are not
+      used anymore are then released from the string pool.
+
+      Returns the amount of removed nodes.
+      */
+    int enforceNodeBudget();
 
     /**
       Computes and update for each node the distance to the closest selected node.
       */
     void updateDistances();
-    void recurseUpdateDistances(Node* node, Node* parent, int distance);
+
+    /**
+      Distances to the selection are only computed up to this amount of
+      edges: MAX_NODE_LEVELS (farther nodes are not rendered), or FOCUS_RADIUS
+      if larger.
+      */
+    static int distanceCap();
+
+    /**
+      Checks the indices of the graph against each other (handles and dense
+      indices, IDs and aliases, edge index, adjacency and relation rows), and
+      the distances to the selection against a full recomputation. Throws an
+      OroViewException describing the first inconsistency found.
+
+      Slow: meant for the tests (cf oroview-test). Must not be called during
+      a batch, whose distances are only propagated by commit().
+      */
+    void checkConsistency() const;
 
     int nodesCount();
     int edgesCount();
 
+    /**
+      Adds the memory used by the graph to 'usage', per subsystem: nodes,
+      edges, relations, interned strings, edge renderers, physics (and
+      layout) state, and the published snapshot. Needs the graph mutex, and
+      must be called from the rendering thread (which updates the edge
+      renderers).
+      */
+    void memoryUsage(MemoryUsage& usage) const;
+
+    /**
+      Coulomb repulsion applied on a node by all the other nodes.
+
+      Depending on REPULSION_ENGINE, it is either computed exactly (in O(N)
+      for one node), approximated with the Barnes-Hut quadtree built at the
+      beginning of the step (in O(log N)), or limited to the nodes closer
+      than GRID_CUTOFF, found with a uniform grid (in O(1) for evenly spread
+      nodes).
+      */
     vec2f coulombRepulsionFor(const Node& node) const;
     vec2f coulombRepulsionAt(const vec2f& pos) const;
 
+    /**
+      Sum of the spring forces of the edges connected to this node. Runs in
+      O(degree of the node).
+      */
     vec2f hookeAttractionFor(const Node& node) const;
 
     /** "Pseudo" gravity that attract nodes towards the center of the screen.
@@ -138,8 +748,6 @@ public:
       */
     vec2f gravityFor(const Node& node) const;
 
-    vec2f project(float force, const vec2f& d) const;
-
     /** Save the current configuration of (displayed) nodes to a file
     (graph.dot)
     **/
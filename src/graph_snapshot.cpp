@@ -0,0 +1,49 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <climits>
+
+#include "memory_usage.h"
+
+#include "graph_snapshot.h"
+
+using namespace std;
+
+NodeHandle GraphSnapshot::Topology::findTag(int tagid) const {
+
+    vector<pair<int, int> >::const_iterator it =
+            lower_bound(tags.begin(), tags.end(), make_pair(tagid, INT_MIN));
+
+    if (it == tags.end() || it->first != tagid)
+        return NodeHandle();
+
+    return nodes[it->second];
+}
+
+size_t GraphSnapshot::memoryUsage() const {
+    size_t bytes = 0;
+
+    if (topology)
+        bytes += capacityBytes(topology->nodes) + capacityBytes(topology->edges) +
+                 capacityBytes(topology->tags);
+    if (positions) bytes += capacityBytes(*positions);
+    if (previous_positions) bytes += capacityBytes(*previous_positions);
+
+    return bytes;
+}
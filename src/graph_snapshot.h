@@ -0,0 +1,78 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GRAPH_SNAPSHOT_H
+#define GRAPH_SNAPSHOT_H
+
+#include <vector>
+#include <utility>
+#include <memory>
+
+#include "core/vectors.h"
+
+#include "node_handle.h"
+
+/**
+  Immutable view of the graph, published by Graph::publishPositions() and
+  Graph::publishTopology() (cf SnapshotChannel): readers (the rendering
+  and the picking) use it without holding the graph mutex.
+
+  Everything is indexed by the dense index of the nodes at the time of the
+  publication. The parts that did not change since the previous snapshot are
+  shared with it.
+  */
+struct GraphSnapshot
+{
+    struct Topology
+    {
+        /** Handle of each node.
+        **/
+        std::vector<NodeHandle> nodes;
+
+        /** Ends of each edge, as node indices.
+        **/
+        std::vector<std::pair<int, int> > edges;
+
+        /** Picking tag of each node (the hash value of its ID) and its index,
+          sorted by tag.
+          */
+        std::vector<std::pair<int, int> > tags;
+
+        /** Returns the handle of the node with the given tag, or a null handle.
+        **/
+        NodeHandle findTag(int tagid) const;
+    };
+
+    std::shared_ptr<const Topology> topology;
+
+    /**
+      Positions of the nodes at the end of the last step, and at the end of
+      the step before (which may cover fewer nodes, or be NULL after nodes have
+      been removed).
+      */
+    std::shared_ptr<const std::vector<vec2f> > positions;
+    std::shared_ptr<const std::vector<vec2f> > previous_positions;
+
+    /**
+      Bytes allocated by the parts of the snapshot (whether or not they are
+      shared with the previous one).
+      */
+    size_t memoryUsage() const;
+};
+
+#endif // GRAPH_SNAPSHOT_H
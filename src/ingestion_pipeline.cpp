@@ -0,0 +1,191 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <chrono>
+#include <utility>
+
+#include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "macros.h"
+#include "graph.h"
+
+#include "ingestion_pipeline.h"
+
+using namespace std;
+
+// Fetched resources waiting for the main loop. Past that, the fetching
+// threads wait: a slow main loop slows the requests down, instead of
+// piling up resources.
+static const size_t MAX_WAITING_RESULTS = 256;
+
+IngestionPipeline::IngestionPipeline(OntologyConnector& oro) :
+    oro(oro),
+    quit(false)
+{
+}
+
+IngestionPipeline::~IngestionPipeline() {
+    stop();
+}
+
+void IngestionPipeline::start(int count) {
+
+    stop();
+
+    quit = false;
+
+    if (count < 1) count = 1;
+
+    for (int i = 0; i < count; ++i)
+        threads.push_back(new boost::thread(&IngestionPipeline::fetchLoop, this));
+
+    TRACE("Ontology fetched by " << count << " threads");
+}
+
+void IngestionPipeline::stop() {
+
+    {
+        boost::lock_guard<boost::mutex> l(mutex);
+        quit = true;
+    }
+    requested_cond.notify_all();
+    drained_cond.notify_all();
+
+    BOOST_FOREACH(boost::thread* t, threads) {
+        t->join();
+        delete t;
+    }
+
+    threads.clear();
+}
+
+void IngestionPipeline::request(const string& id, int depth, bool active) {
+
+    if (depth <= 0) return;
+
+    {
+        boost::lock_guard<boost::mutex> l(mutex);
+
+        map<string, int>::iterator it = pending.find(id);
+
+        if (it != pending.end()) {
+            if (it->second >= depth && !active) return;
+            it->second = MAX(it->second, depth);
+        }
+        else pending[id] = depth;
+
+        Request request = {id, depth, active};
+        requests.push_back(request);
+    }
+    requested_cond.notify_one();
+}
+
+bool IngestionPipeline::ready() const {
+    boost::lock_guard<boost::mutex> l(mutex);
+    return !results.empty();
+}
+
+int IngestionPipeline::pendingCount() const {
+    boost::lock_guard<boost::mutex> l(mutex);
+    return pending.size();
+}
+
+int IngestionPipeline::ingest(Graph& graph, float budget, vector<string>& activated) {
+
+    typedef chrono::steady_clock Clock;
+
+    if (!ready()) return 0;
+
+    Clock::time_point start = Clock::now();
+    int count = 0;
+
+    // Distances to the selection are updated once, for all the resources
+    Graph::Batch batch(graph);
+
+    while (true) {
+        Result result;
+        {
+            boost::lock_guard<boost::mutex> l(mutex);
+
+            if (results.empty()) break;
+
+            result.request = results.front().request;
+            result.found = results.front().found;
+            swap(result.details, results.front().details);
+            results.pop_front();
+
+            map<string, int>::iterator it = pending.find(result.request.id);
+            if (it != pending.end() && it->second <= result.request.depth) pending.erase(it);
+        }
+        drained_cond.notify_one();
+
+        vector<string> linked;
+
+        if (result.found && oro.addResource(result.details, graph, linked)) {
+            ++count;
+
+            if (result.request.active) activated.push_back(result.request.id);
+
+            BOOST_FOREACH(const string& id, linked) {
+                request(id, result.request.depth - 1);
+            }
+        }
+
+        if (chrono::duration<float, milli>(Clock::now() - start).count() >= budget) break;
+    }
+
+    return count;
+}
+
+void IngestionPipeline::fetchLoop() {
+
+    while (true) {
+        Result result;
+        {
+            boost::unique_lock<boost::mutex> l(mutex);
+            while (!quit && requests.empty()) requested_cond.wait(l);
+
+            if (quit) return;
+
+            result.request = requests.front();
+            requests.pop_front();
+        }
+
+        try {
+            result.found = oro.fetch(result.request.id, result.details);
+        }
+        catch (std::exception& e) {
+            cerr << "Could not fetch " << result.request.id << " from the ontology: " << e.what() << endl;
+            result.found = false;
+        }
+
+        {
+            boost::unique_lock<boost::mutex> l(mutex);
+            while (!quit && results.size() >= MAX_WAITING_RESULTS) drained_cond.wait(l);
+
+            if (quit) return;
+
+            results.push_back(Result());
+            results.back().request = result.request;
+            results.back().found = result.found;
+            swap(results.back().details, result.details);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef INGESTION_PIPELINE_H
+#define INGESTION_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "oro_connector.h"
+
+class Graph;
+
+/**
+  Walks through the ontology in the background, without ever blocking the
+  main loop on the server.
+
+  Resources are fetched and parsed by a pool of threads (cf
+  OntologyConnector::fetch()): there are at most as many requests in flight
+  as threads. Parsed resources wait in a queue until the main loop adds
+  them to the graph with ingest(), within a time budget per frame. Their
+  neighbours are then requested in turn, until the requested depth is
+  reached (as with OntologyConnector::walkThroughOntology()).
+  */
+class IngestionPipeline
+{
+public:
+    IngestionPipeline(OntologyConnector& oro);
+    ~IngestionPipeline();
+
+    /**
+      Starts 'threads' fetching threads (at least one).
+      */
+    void start(int threads);
+    void stop();
+
+    /**
+      Queues a resource to be added with its neighbours, up to 'depth' edges
+      away. Returns immediately. A resource already waiting (or in flight)
+      for at least that depth is not requested again.
+      If 'active' is true, ingest() reports the resource once it is added.
+      */
+    void request(const std::string& id, int depth, bool active = false);
+
+    /**
+      Adds the fetched resources to the graph, oldest first, until 'budget'
+      milliseconds have been spent (at least one resource is added, if any is
+      ready). The ids of the active resources that have been added are
+      appended to 'activated'. Needs the graph mutex.
+      Returns the amount of resources added.
+      */
+    int ingest(Graph& graph, float budget, std::vector<std::string>& activated);
+
+    /**
+      True if fetched resources are waiting for ingest().
+      */
+    bool ready() const;
+
+    /**
+      Resources requested, but not added yet.
+      */
+    int pendingCount() const;
+
+private:
+    struct Request {
+        std::string id;
+        int depth;
+        bool active;
+    };
+
+    struct Result {
+        Request request;
+        bool found;
+        ResourceDetails details;
+    };
+
+    OntologyConnector& oro;
+
+    std::vector<boost::thread*> threads;
+
+    mutable boost::mutex mutex;
+    boost::condition_variable requested_cond;
+    boost::condition_variable drained_cond;
+
+    // Only accessed while holding 'mutex'
+    std::deque<Request> requests;
+    std::deque<Result> results;
+    // Depth each resource waiting or in flight is requested for
+    std::map<std::string, int> pending;
+    bool quit;
+
+    void fetchLoop();
+};
+
+#endif // INGESTION_PIPELINE_H
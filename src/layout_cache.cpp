@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include <boost/cstdint.hpp>
+#include <boost/foreach.hpp>
+
+#include "oroview_exceptions.h"
+
+#include "layout_cache.h"
+
+using namespace std;
+
+static const char LAYOUT_MAGIC[4] = {'O', 'R', 'L', 'C'};
+static const boost::uint32_t LAYOUT_VERSION = 1;
+
+// Node IDs are URIs or short concept names: anything longer is garbage.
+static const boost::uint32_t MAX_ID_LENGTH = 64 * 1024;
+
+template<typename T>
+static bool readValue(istream& in, T& value) {
+    return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static void writeValue(ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void LayoutCache::clear() {
+    positions.clear();
+}
+
+void LayoutCache::set(const string& id, const vec2f& pos) {
+    positions[id] = pos;
+}
+
+bool LayoutCache::get(const string& id, vec2f& pos) const {
+    PositionMap::const_iterator it = positions.find(id);
+
+    if (it == positions.end()) return false;
+
+    pos = it->second;
+    return true;
+}
+
+int LayoutCache::size() const {
+    return positions.size();
+}
+
+bool LayoutCache::load(const string& path) {
+
+    positions.clear();
+
+    ifstream in(path.c_str(), ifstream::binary);
+    if (!in) return false;
+
+    in.seekg(0, ifstream::end);
+    streamoff file_size = in.tellg();
+    in.seekg(0, ifstream::beg);
+
+    char magic[4];
+    boost::uint32_t version, count;
+
+    if (!in.read(magic, 4) || !equal(magic, magic + 4, LAYOUT_MAGIC) ||
+        !readValue(in, version) || version != LAYOUT_VERSION ||
+        !readValue(in, count)) {
+        cerr << path << " is not a valid layout file. Ignoring it." << endl;
+        return false;
+    }
+
+    string id;
+
+    for (boost::uint32_t i = 0; i < count; ++i) {
+        boost::uint32_t length;
+        vec2f pos;
+
+        if (readValue(in, length)) {
+            // A corrupted length would allocate gigabytes before the read fails
+            if (length > MAX_ID_LENGTH || (streamoff) length > file_size - in.tellg()) {
+                cerr << path << " is not a valid layout file. Ignoring it." << endl;
+                positions.clear();
+                return false;
+            }
+
+            id.resize(length);
+            if (length > 0) in.read(&id[0], length);
+        }
+
+        if (!in || !readValue(in, pos.x) || !readValue(in, pos.y)) {
+            cerr << "Layout file " << path << " is truncated. Ignoring it." << endl;
+            positions.clear();
+            return false;
+        }
+
+        positions[id] = pos;
+    }
+
+    return true;
+}
+
+void LayoutCache::save(const string& path) const {
+
+    ofstream out(path.c_str(), ofstream::binary | ofstream::trunc);
+    if (!out)
+        throw OroViewException("Can not write the layout to " + path);
+
+    out.write(LAYOUT_MAGIC, 4);
+    writeValue(out, LAYOUT_VERSION);
+    writeValue(out, (boost::uint32_t) positions.size());
+
+    BOOST_FOREACH(const PositionMap::value_type& p, positions) {
+        writeValue(out, (boost::uint32_t) p.first.size());
+        out.write(p.first.data(), p.first.size());
+        writeValue(out, p.second.x);
+        writeValue(out, p.second.y);
+    }
+
+    if (!out)
+        throw OroViewException("Error while writing the layout to " + path);
+}
@@ -0,0 +1,68 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LAYOUT_CACHE_H
+#define LAYOUT_CACHE_H
+
+#include <map>
+#include <string>
+
+#include "core/vectors.h"
+
+/**
+  Positions of nodes, keyed by node ID, that can be saved to and loaded from
+  a compact binary file. Written by the oroview-layout tool, and used by
+  oro-view to start with an already laid out graph (cf Graph::applyLayout()).
+
+  File format (native endianness):
+   - magic "ORLC", then format version, as a 32 bits integer
+   - amount of nodes, as a 32 bits integer
+   - for each node: length of the ID (32 bits integer), the ID (without
+     trailing zero), then x and y (32 bits floats)
+  */
+class LayoutCache
+{
+public:
+    typedef std::map<std::string, vec2f> PositionMap;
+
+    void clear();
+    void set(const std::string& id, const vec2f& pos);
+
+    /**
+      Returns false (and leaves 'pos' untouched) if the node is not in the
+      cache.
+      */
+    bool get(const std::string& id, vec2f& pos) const;
+
+    int size() const;
+
+    /**
+      Replaces the content of the cache with the file content. Returns false
+      if the file does not exist or is not a valid layout file.
+      */
+    bool load(const std::string& path);
+
+    /**
+      Throws an OroViewException if the file can not be written.
+      */
+    void save(const std::string& path) const;
+
+private:
+    PositionMap positions;
+};
+
+#endif // LAYOUT_CACHE_H
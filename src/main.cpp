@@ -53,6 +53,8 @@ int main(int argc, char *argv[]) {
             ("fullscreen,f", "fullscreen")
             ("g", po::value<string>()->default_value("1024x768"), "window geometry (LxH)")
             ("configuration", po::value<string>(), "rendering configuration (JSON, optional)")
+            ("seed", po::value<unsigned int>(), "seed of the random generator, for reproducible layouts (overrides the configuration)")
+            ("load-snapshot", po::value<string>(), "load the graph from this snapshot instead of the ontology (overrides the configuration)")
             ;
 
     po::variables_map vm;
@@ -121,6 +123,14 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (vm.count("seed")) {
+        config["physics"]["seed"] = vm["seed"].as<unsigned int>();
+    }
+
+    if (vm.count("load-snapshot")) {
+        config["load_snapshot"] = vm["load-snapshot"].as<string>();
+    }
+
     SDLAppInit("Memory View", "memory-view");
 
 #ifndef TEXT_ONLY
@@ -0,0 +1,86 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fstream>
+
+#include <boost/foreach.hpp>
+
+#include <json/json.h>
+
+#include "oroview_exceptions.h"
+
+#include "memory_usage.h"
+
+using namespace std;
+
+typedef pair<string, size_t> Entry;
+
+void MemoryUsage::add(const string& subsystem, size_t amount) {
+    BOOST_FOREACH(Entry& entry, bytes) {
+        if (entry.first == subsystem) {
+            entry.second += amount;
+            return;
+        }
+    }
+    bytes.push_back(Entry(subsystem, amount));
+}
+
+void MemoryUsage::count(const string& item, size_t amount) {
+    amounts.push_back(Entry(item, amount));
+}
+
+size_t MemoryUsage::get(const string& subsystem) const {
+    BOOST_FOREACH(const Entry& entry, bytes) {
+        if (entry.first == subsystem) return entry.second;
+    }
+    return 0;
+}
+
+size_t MemoryUsage::total() const {
+    size_t sum = 0;
+    BOOST_FOREACH(const Entry& entry, bytes) sum += entry.second;
+    return sum;
+}
+
+Json::Value MemoryUsage::toJson() const {
+    Json::Value root;
+
+    BOOST_FOREACH(const Entry& entry, bytes) {
+        root["bytes"][entry.first] = Json::UInt64(entry.second);
+    }
+    root["bytes"]["total"] = Json::UInt64(total());
+
+    BOOST_FOREACH(const Entry& entry, amounts) {
+        root["counts"][entry.first] = Json::UInt64(entry.second);
+    }
+
+    return root;
+}
+
+void MemoryUsage::save(const string& path) const {
+    ofstream file(path.c_str());
+
+    if (!file)
+        throw OroViewException("Could not write the memory usage to " + path);
+
+    Json::StyledStreamWriter writer;
+    writer.write(file, toJson());
+
+    if (!file)
+        throw OroViewException("Could not write the memory usage to " + path);
+}
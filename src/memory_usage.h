@@ -0,0 +1,86 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace Json {
+class Value;
+}
+
+/**
+  Memory used by each subsystem of the viewer (graph nodes, edges,
+  relations, renderers, fonts, textures...), in bytes, along with the
+  amount of items it stores. Filled by the memoryUsage() hooks of the
+  subsystems, shown in the debug overlay and saved as JSON to size
+  deployments.
+
+  The hooks count what the containers have allocated (their capacity), not
+  what they use, nor the overhead of the allocator.
+  */
+class MemoryUsage
+{
+public:
+    typedef std::vector<std::pair<std::string, size_t> > Entries;
+
+    void add(const std::string& subsystem, size_t bytes);
+    void count(const std::string& item, size_t amount);
+
+    size_t get(const std::string& subsystem) const;
+    size_t total() const;
+
+    const Entries& subsystems() const {return bytes;}
+    const Entries& counts() const {return amounts;}
+
+    Json::Value toJson() const;
+
+    /**
+      Throws an OroViewException if the file can not be written.
+      */
+    void save(const std::string& path) const;
+
+private:
+    Entries bytes;
+    Entries amounts;
+};
+
+/**
+  Bytes allocated by a vector (or any container with contiguous storage).
+  */
+template <class Vector>
+size_t capacityBytes(const Vector& v) {
+    return v.capacity() * sizeof(typename Vector::value_type);
+}
+
+/**
+  Estimate of the bytes allocated by an unordered container: its bucket
+  array, and one node per element (the element, the link to the next node
+  and the cached hash value).
+  */
+template <class Hash>
+size_t hashTableBytes(const Hash& h) {
+    return h.bucket_count() * sizeof(void*) +
+           h.size() * (sizeof(typename Hash::value_type) + sizeof(void*) + sizeof(size_t));
+}
+
+#endif // MEMORY_USAGE_H
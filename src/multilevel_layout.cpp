@@ -0,0 +1,331 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+#include <boost/bind/bind.hpp>
+
+#include "macros.h"
+#include "constants.h"
+
+#include "multilevel_layout.h"
+
+using namespace std;
+using namespace boost::placeholders;
+
+// Coarsening stops when the graph has less nodes than this...
+static const int COARSEST_SIZE = 16;
+// ...or when a level does not shrink the graph by at least 10%.
+static const float MIN_COARSENING_RATIO = 0.9;
+
+static const int COARSEST_ITERATIONS = 200;
+static const int REFINE_ITERATIONS = 30;
+
+// Temperature at the end of the refinement of a level, relative to the
+// initial temperature.
+static const float FINAL_TEMPERATURE_RATIO = 0.01;
+
+/** Orders nodes by weight, then by degree (lightest first).
+**/
+struct LighterNode {
+    const vector<float>& weights;
+    const vector<int>& offsets;
+
+    LighterNode(const vector<float>& weights, const vector<int>& offsets) :
+        weights(weights), offsets(offsets) {}
+
+    bool operator()(int a, int b) const {
+        if (weights[a] != weights[b]) return weights[a] < weights[b];
+        return offsets[a + 1] - offsets[a] < offsets[b + 1] - offsets[b];
+    }
+};
+
+int MultilevelLayout::Level::size() const {
+    return weights.size();
+}
+
+MultilevelLayout::MultilevelLayout(WorkerPool& workers) :
+    workers(workers),
+    level(NULL),
+    temperature(0.0)
+{
+}
+
+int MultilevelLayout::levelsCount() const {
+    return levels.size();
+}
+
+void MultilevelLayout::run(const AdjacencyIndex& adjacency, vector<vec2f>& positions) {
+
+    int count = adjacency.nodesCount();
+
+    levels.clear();
+    positions.clear();
+
+    if (count == 0) return;
+
+    // Level 0: the graph itself
+    levels.push_back(Level());
+    Level& graph = levels.back();
+
+    graph.weights.assign(count, 1.0);
+    graph.offsets.push_back(0);
+
+    for (int i = 0; i < count; ++i) {
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            if (n->node == i) continue;
+            graph.neighbours.push_back(n->node);
+            graph.edge_weights.push_back(1.0);
+        }
+        graph.offsets.push_back(graph.neighbours.size());
+    }
+
+    // Coarsening
+    while (levels.back().size() > COARSEST_SIZE) {
+        Level coarse;
+        if (!coarsen(levels.back(), coarse)) break;
+        levels.push_back(coarse);
+    }
+
+    TRACE("Multilevel layout: " << levels.size() << " levels, coarsest has " << levels.back().size() << " nodes");
+
+    // Layout of the coarsest level, starting from a circle
+    int n = levels.back().size();
+    float radius = NOMINAL_EDGE_LENGTH * sqrt((float) n);
+
+    pos.resize(n);
+    for (int i = 0; i < n; ++i) {
+        float angle = 2 * M_PI * i / n;
+        pos[i] = vec2f(cos(angle), sin(angle)) * radius;
+    }
+
+    level = &levels.back();
+    refine(COARSEST_ITERATIONS, radius);
+
+    // Back to the original graph, level by level
+    for (int l = levels.size() - 2; l >= 0; --l) {
+        place(l);
+        level = &levels[l];
+        refine(REFINE_ITERATIONS, NOMINAL_EDGE_LENGTH);
+    }
+
+    vec2f centre(0.0, 0.0);
+    for (int i = 0; i < count; ++i) centre += pos[i];
+    centre /= count;
+
+    positions.resize(count);
+    for (int i = 0; i < count; ++i) positions[i] = pos[i] - centre;
+}
+
+bool MultilevelLayout::coarsen(Level& fine, Level& coarse) {
+
+    int n = fine.size();
+
+    // Heavy edge matching. Light nodes are visited first, to keep the
+    // weights of the groups balanced.
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    stable_sort(order.begin(), order.end(), LighterNode(fine.weights, fine.offsets));
+
+    vector<int> match(n, -1);
+
+    BOOST_FOREACH(int u, order) {
+        if (match[u] != -1) continue;
+
+        int best = -1;
+        float best_weight = 0.0;
+
+        for (int e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+            int v = fine.neighbours[e];
+            if (v == u || match[v] != -1) continue;
+
+            float w = fine.edge_weights[e];
+            if (best == -1 || w > best_weight ||
+                    (w == best_weight && fine.weights[v] < fine.weights[best])) {
+                best = v;
+                best_weight = w;
+            }
+        }
+
+        if (best != -1) {
+            match[u] = best;
+            match[best] = u;
+        }
+    }
+
+    // Each matched pair becomes a group
+    fine.groups.assign(n, -1);
+    coarse.weights.clear();
+
+    for (int u = 0; u < n; ++u) {
+        if (match[u] == -1 || fine.groups[u] != -1) continue;
+
+        fine.groups[u] = fine.groups[match[u]] = coarse.weights.size();
+        coarse.weights.push_back(fine.weights[u] + fine.weights[match[u]]);
+    }
+
+    // Unmatched nodes have only matched neighbours (typically, the leaves of
+    // a star): they join the lightest neighbouring group. Isolated nodes
+    // stay alone.
+    for (int u = 0; u < n; ++u) {
+        if (fine.groups[u] != -1) continue;
+
+        int best = -1;
+        for (int e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+            int g = fine.groups[fine.neighbours[e]];
+            if (g != -1 && (best == -1 || coarse.weights[g] < coarse.weights[best]))
+                best = g;
+        }
+
+        if (best == -1) {
+            best = coarse.weights.size();
+            coarse.weights.push_back(0.0);
+        }
+
+        fine.groups[u] = best;
+        coarse.weights[best] += fine.weights[u];
+    }
+
+    int groups_count = coarse.weights.size();
+
+    if (groups_count > MIN_COARSENING_RATIO * n) return false;
+
+    // Members of each group
+    vector<int> members_offsets(groups_count + 1, 0);
+    for (int u = 0; u < n; ++u) members_offsets[fine.groups[u] + 1]++;
+    for (int g = 0; g < groups_count; ++g) members_offsets[g + 1] += members_offsets[g];
+
+    vector<int> members(n);
+    vector<int> fill(members_offsets.begin(), members_offsets.end() - 1);
+    for (int u = 0; u < n; ++u) members[fill[fine.groups[u]]++] = u;
+
+    // Edges between groups. Parallel edges are merged, their weights summed.
+    vector<int> last_seen(groups_count, -1);
+    vector<int> edge_slot(groups_count, -1);
+
+    coarse.offsets.assign(1, 0);
+    coarse.neighbours.clear();
+    coarse.edge_weights.clear();
+
+    for (int g = 0; g < groups_count; ++g) {
+        for (int m = members_offsets[g]; m < members_offsets[g + 1]; ++m) {
+            int u = members[m];
+
+            for (int e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+                int h = fine.groups[fine.neighbours[e]];
+                if (h == g) continue;
+
+                if (last_seen[h] != g) {
+                    last_seen[h] = g;
+                    edge_slot[h] = coarse.neighbours.size();
+                    coarse.neighbours.push_back(h);
+                    coarse.edge_weights.push_back(fine.edge_weights[e]);
+                }
+                else coarse.edge_weights[edge_slot[h]] += fine.edge_weights[e];
+            }
+        }
+        coarse.offsets.push_back(coarse.neighbours.size());
+    }
+
+    return true;
+}
+
+void MultilevelLayout::place(int fine_level) {
+
+    const Level& fine = levels[fine_level];
+    int n = fine.size();
+    int groups_count = levels[fine_level + 1].size();
+
+    vector<int> sizes(groups_count, 0);
+    for (int u = 0; u < n; ++u) sizes[fine.groups[u]]++;
+
+    // Members of a group are spread on a small circle around the position
+    // of the group: coincident nodes would not repulse each other.
+    vector<int> ranks(groups_count, 0);
+    next_pos.resize(n);
+
+    for (int u = 0; u < n; ++u) {
+        int g = fine.groups[u];
+
+        if (sizes[g] == 1) {
+            next_pos[u] = pos[g];
+            continue;
+        }
+
+        float angle = 2 * M_PI * ranks[g]++ / sizes[g];
+        next_pos[u] = pos[g] + vec2f(cos(angle), sin(angle)) * (NOMINAL_EDGE_LENGTH * 0.25);
+    }
+
+    pos.swap(next_pos);
+}
+
+void MultilevelLayout::refine(int iterations, float initial_temperature) {
+
+    int n = level->size();
+
+    float cooling = pow(FINAL_TEMPERATURE_RATIO, 1.0f / iterations);
+    temperature = initial_temperature;
+
+    next_pos.resize(n);
+
+    for (int it = 0; it < iterations; ++it) {
+
+        vec2f min = pos[0];
+        vec2f max = pos[0];
+        for (int i = 1; i < n; ++i) {
+            min.x = MIN(min.x, pos[i].x); min.y = MIN(min.y, pos[i].y);
+            max.x = MAX(max.x, pos[i].x); max.y = MAX(max.y, pos[i].y);
+        }
+
+        tree.setTheta(BARNES_HUT_THETA);
+        tree.reset(min, max, COULOMB_CONSTANT);
+        for (int i = 0; i < n; ++i)
+            tree.insert(i, pos[i], level->weights[i] * INITIAL_CHARGE);
+        tree.computeCharges();
+
+        workers.parallelFor(n, boost::bind(&MultilevelLayout::moveNodes, this, _1, _2));
+
+        pos.swap(next_pos);
+        temperature *= cooling;
+    }
+}
+
+void MultilevelLayout::moveNodes(int begin, int end) {
+
+    for (int u = begin; u < end; ++u) {
+
+        vec2f force = tree.repulsionAt(pos[u], level->weights[u] * INITIAL_CHARGE, u);
+
+        for (int e = level->offsets[u]; e < level->offsets[u + 1]; ++e) {
+            vec2f delta = pos[level->neighbours[e]] - pos[u];
+            float len = delta.length();
+            if (len == 0.0) continue;
+
+            float f = INITIAL_SPRING_CONSTANT * level->edge_weights[e] * (len - NOMINAL_EDGE_LENGTH);
+            force += delta * (f / len);
+        }
+
+        // Nodes move along the force, by at most 'temperature' pixels
+        float len = force.length();
+        if (len > 0.0)
+            next_pos[u] = pos[u] + force * (MIN(len, temperature) / len);
+        else
+            next_pos[u] = pos[u];
+    }
+}
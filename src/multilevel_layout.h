@@ -0,0 +1,98 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MULTILEVEL_LAYOUT_H
+#define MULTILEVEL_LAYOUT_H
+
+#include <vector>
+
+#include "core/vectors.h"
+
+#include "adjacency.h"
+#include "barnes_hut.h"
+#include "worker_pool.h"
+
+/**
+  Multilevel force-directed layout (in the spirit of Walshaw's algorithm),
+  used to compute a readable initial placement of large graphs.
+
+  The graph is first coarsened: at each level, nodes are paired along their
+  heaviest edges (heavy edge matching), and the nodes that remain unmatched
+  join the lightest neighbouring pair. Each group becomes one node of the
+  next level, whose weight (and thus charge) is the amount of nodes it
+  stands for.
+
+  The coarsest graph (a handful of nodes) is laid out first. Then, level by
+  level, every node is placed around the position of its group, and the
+  layout is refined by a few iterations of the same forces as the physics
+  (Coulomb repulsion, computed with a Barnes-Hut tree, and springs), with
+  displacements limited by a decreasing temperature.
+  */
+class MultilevelLayout
+{
+public:
+    MultilevelLayout(WorkerPool& workers);
+
+    /**
+      Computes the layout of the graph described by 'adjacency'. The
+      positions of the nodes (by index) are written to 'positions'. The
+      layout is centred on (0, 0).
+      */
+    void run(const AdjacencyIndex& adjacency, std::vector<vec2f>& positions);
+
+    /**
+      Amount of levels used by the last run (1 means no coarsening).
+      */
+    int levelsCount() const;
+
+private:
+    struct Level {
+        // adjacency, in CSR format: neighbours of node i are in
+        // [offsets[i], offsets[i+1])
+        std::vector<int> offsets;
+        std::vector<int> neighbours;
+        std::vector<float> edge_weights;
+
+        // amount of nodes of the original graph each node stands for
+        std::vector<float> weights;
+
+        // index of the group of each node in the next (coarser) level
+        std::vector<int> groups;
+
+        int size() const;
+    };
+
+    WorkerPool& workers;
+
+    std::vector<Level> levels;
+
+    BarnesHutTree tree;
+
+    // Positions at the current level, and their update
+    std::vector<vec2f> pos;
+    std::vector<vec2f> next_pos;
+
+    const Level* level;
+    float temperature;
+
+    bool coarsen(Level& fine, Level& coarse);
+    void place(int fine_level);
+    void refine(int iterations, float initial_temperature);
+    void moveNodes(int begin, int end);
+};
+
+#endif // MULTILEVEL_LAYOUT_H
@@ -26,7 +26,6 @@
 #include "oroview.h"
 #include "graph.h"
 #include "node.h"
-#include "node_relation.h"
 
 
 using namespace std;
@@ -39,203 +38,107 @@ bool safeIdFilter(char c) {
     return c=='-' || c==':' || c=='_';
 }
 
-Node::Node(const string& id, const string& label, const Node* neighbour, node_type type) :
+Node::Node(Symbol id, Symbol label, RandomGenerator& rng, const Node* neighbour, node_type type) :
     id(id),
-    safeid(id),
-    label(label),
-    renderer(NodeRenderer(hash_value(id), label, type)),
-    selected(false),
-    decayTime(0.0),
-    decaySpeed(1.0),
-    decaying(true),
-    distance_to_selected(-1),
-    distance_to_selected_updated(false),
-    base_charge(INITIAL_CHARGE),
-    charge(INITIAL_CHARGE)
+    renderer(NodeRenderer(hash_value(id.str()), label, type))
 {
 
-    safeid.resize(std::remove_if(safeid.begin(), safeid.end(), safeIdFilter) - safeid.begin());
-
     //If a neighbour is given, we set our initial position close to it.
-    if (neighbour != NULL)
-        pos = neighbour->pos + vec2f(10.0 * (float)rand()/RAND_MAX - 5 , 10.0 * (float)rand()/RAND_MAX - 5);
-    else
-        pos = vec2f(100.0 * (float)rand()/RAND_MAX - 50 , 100 * (float)rand()/RAND_MAX - 50);
-
-    speed = vec2f(0.0, 0.0);
-
-    mass = INITIAL_MASS;
-    damping = INITIAL_DAMPING;
+    //(x and y are drawn in two statements: the evaluation order of function
+    //arguments is unspecified, and the layout must not depend on the compiler)
+    float spread = (neighbour != NULL) ? 5.0 : 50.0;
+    float x = rng.uniform(-spread, spread);
+    float y = rng.uniform(-spread, spread);
 
+    vec2f position(x, y);
+    if (neighbour != NULL) position += neighbour->pos;
 
+    init(position);
 }
 
-bool Node::operator< (const Node& node2) const {
-    return id < node2.getID();
-}
-
-const string& Node::getID() const {
-    return id;
-}
-
-const string& Node::getSafeID() const {
-    return safeid;
-}
-
-void Node::setColour(vec4f col) {
-    renderer.setColour(col);
-}
-
-std::vector<NodeRelation>& Node::getRelations() {
-    return relations;
-}
-
-vector<Node*>  Node::getConnectedNodes(){
-    vector<Node*> res;
-
-    BOOST_FOREACH(NodeRelation& rel, relations) {
-        if (rel.to == this)
-            res.push_back(rel.from);
-        else
-            res.push_back(rel.to);
-    }
-    return res;
-}
-
-bool Node::isConnectedTo(Node* node) {
-    BOOST_FOREACH(NodeRelation& rel, relations) {
-        if (rel.to == node || rel.from == node)
-            return true;
-    }
-    return false;
+Node::Node(Symbol id, int tagid, Symbol label, node_type type, const vec2f& position) :
+    id(id),
+    renderer(NodeRenderer(tagid, label, type))
+{
+    init(position);
 }
 
-NodeRelation& Node::addRelation(Node& to, const relation_type type, const std::string& label) {
-
-    //When adding a new relation, we create as well an initial UNDEFINED reciprocal relation if
-    //the destination node has no back relation.
-    //And before adding a relation, we check there is no existing UNDEFINED relation.
-    //If it's the case, we can safely replace it by a well defined relation.
-
-//    if (type == UNDEFINED) {
-//	//Add an undefined relation and return.
-//	relations.push_back(NodeRelation(this, &to, UNDEFINED, ""));
-//	TRACE("Added UNDEFINED back relation to " << to.getID());
-//	return;
-//    }
-
-    vector<const NodeRelation*> rels = getRelationTo(to);
-
-    relations.push_back(NodeRelation(this, &to, type, label)); //Add a new relation
+void Node::init(const vec2f& position) {
 
-    if (!to.isConnectedTo(this)){
-        to.addRelation(*this, UNDEFINED, "");
-    }
-
-    if(rels.size() == 1 && rels[0]->type == UNDEFINED) { //I had already an undefined relation to the destination node
+    selected = false;
+    decayTime = 0.0;
+    decaySpeed = 1.0;
+    decaying = true;
+    distance_to_selected = -1;
+    distance_to_selected_updated = false;
+    base_charge = INITIAL_CHARGE;
+    charge = INITIAL_CHARGE;
 
-    TRACE("Will replaced an old UNDEFINED relation by a better one!");
+    pos = position;
+    render_pos = pos;
 
-    //**** TODO !!! *****/
+    speed = vec2f(0.0, 0.0);
+    kinetic_energy = 0.0;
+    index = -1;
 
-    //if (edge_p != NULL)
-    //    edge_p->removeReferenceRelation(*this);
+    asleep = false;
+    calm_time = 0.0;
 
-    //std::remove(relations.begin(), relations.end(), *(rels[0]));
-    }
+    last_activity = 0;
 
-    TRACE("Added relation from " << id << " to " << to.getID());
+    mass = INITIAL_MASS;
+    damping = INITIAL_DAMPING;
 
-    return relations.back();
 
 }
 
-vector<const NodeRelation*> Node::getRelationTo(Node& node) const {
-
-    vector<const NodeRelation*> res;
-
-    BOOST_FOREACH(const NodeRelation& rel, relations) {
-        if (rel.to == &node)
-            res.push_back(&rel);
-    }
-    return res;
+bool Node::operator< (const Node& node2) const {
+    return getID() < node2.getID();
 }
 
-
-void Node::updateKineticEnergy() {
-    kinetic_energy = mass * speed.length2();
+const string& Node::getID() const {
+    return id.str();
 }
 
+string Node::getSafeID() const {
+    string safeid(getID());
+    safeid.resize(std::remove_if(safeid.begin(), safeid.end(), safeIdFilter) - safeid.begin());
+    return safeid;
+}
 
-void Node::step(Graph& g, float dt){
-
-    /** Compute here the new position of the node **/
-
-    TRACE("Stepping for node " << id);
-    vec2f force = vec2f(0.0, 0.0);
-
-    if(!selected) {
-        // Algo from Wikipedia -- http://en.wikipedia.org/wiki/Force-based_layout
-
-        coulombForce = g.coulombRepulsionFor(*this);
-        force +=coulombForce;
-
-        hookeForce = g.hookeAttractionFor(*this);
-        force += hookeForce;
-    }
-    else { //selected node
-        vec2f gravityForce = g.gravityFor(*this);
-        force += gravityForce;
-
-        coulombForce = g.coulombRepulsionFor(*this);
-        force +=coulombForce;
-    }
-
-    TRACE("** Total force applying: Fx=" << force.x << ", Fy= " << force.y);
-
-    speed = (speed + force * dt) * damping;
-    speed.x = CLAMP(speed.x, -MAX_SPEED, MAX_SPEED);
-    speed.y = CLAMP(speed.y, -MAX_SPEED, MAX_SPEED);
-
-    updateKineticEnergy();
-
-    //Check we have enough energy to move :)
-    if (kinetic_energy > MIN_KINETIC_ENERGY) {
-        pos += speed * dt;
-    }
-
-        if (decaying) decayTime += dt;
-        decay();
-        //Update the age of the node renderer
-        renderer.increment_idle_time(dt);
-
-    TRACE("Node " << id << " now in pos=(" << pos.x << ", " << pos.y <<")");
-
+void Node::setColour(vec4f col) {
+    renderer.setColour(col);
+}
 
-    //TRACE("Step computed for " << id << ". Speed is " << speed.x << ", " << speed.y << " (energy: " << kinetic_energy << ").");
+void Node::updateDecay(float dt){
 
+    if (decaying) decayTime += dt;
+    decay();
 }
 
-void Node::render(rendering_mode mode, OroView& env, bool debug){
+void Node::render(rendering_mode mode, OroView& env){
 
 #ifndef TEXT_ONLY
         if (distance_to_selected >= MAX_NODE_LEVELS) return;
 
         if (mode == GRAPHVIZ) {
-            env.graphvizGraph << safeid;
+            env.graphvizGraph << getSafeID();
         }
-        renderer.draw(pos, mode, env, distance_to_selected);
+        renderer.draw(render_pos, mode, env, distance_to_selected);
 
-        if (debug) {
-            vec4f col(1.0, 0.2, 0.2, 0.7);
-            OroView::drawVector(hookeForce , pos, col);
+#endif
 
-            col = vec4f(0.2, 1.0, 0.2, 0.7);
-            OroView::drawVector(coulombForce , pos, col);
-        }
+}
 
-#endif
+void Node::renderForces() const {
+
+    if (distance_to_selected >= MAX_NODE_LEVELS) return;
+
+    vec4f col(1.0, 0.2, 0.2, 0.7);
+    OroView::drawVector(hookeForce , render_pos, col);
 
+    col = vec4f(0.2, 1.0, 0.2, 0.7);
+    OroView::drawVector(coulombForce , render_pos, col);
 }
 
 void Node::decay() {
@@ -25,7 +25,9 @@
 
 #include "styles.h"
 #include "node_renderer.h"
-#include "node_relation.h"
+#include "node_handle.h"
+#include "random_generator.h"
+#include "string_pool.h"
 
 class Graph;
 class OroView;
@@ -40,17 +42,25 @@ class Node
 
     float base_charge;
 
-    std::vector<NodeRelation> relations;
+    // The label is only stored by the renderer
+    Symbol id;
 
-    std::string id;
-    std::string safeid; //same as ID, with special chars removed (cf safeIdFilter())
-    std::string label;
-
-    void updateKineticEnergy();
+    void init(const vec2f& position);
 
 public:
 
-    Node(const std::string& id, const std::string& label, const Node* neighbour = NULL, node_type type = CLASS_NODE);
+    /**
+      The initial position of the node is drawn from 'rng': close to the
+      neighbour, if any, else around the origin.
+      */
+    Node(Symbol id, Symbol label, RandomGenerator& rng, const Node* neighbour = NULL, node_type type = CLASS_NODE);
+
+    /**
+      Node at a known position, with a known tag (the hash value of its ID,
+      cf NodeRenderer::getTagID()): the ID is not read, eg when a snapshot
+      is loaded (cf Graph::loadSnapshot()).
+      */
+    Node(Symbol id, int tagid, Symbol label, node_type type, const vec2f& position);
 
     bool operator< (const Node& node) const;
 
@@ -63,11 +73,44 @@ public:
     vec2f speed;
     vec2f pos;
 
+    /** Position where the node is drawn: interpolated between the positions
+      published by the two last physics steps (cf Graph::interpolate).
+    **/
+    vec2f render_pos;
+
+    /** Handle of the node in the graph (cf Graph::getNode). Set by the graph
+      when the node is inserted.
+    **/
+    NodeHandle handle;
+
+    /** Dense index of the node in the graph: position of the node in the
+      graph's slot map, and in the physics store.
+    **/
+    int index;
+
+    /** Sleeping nodes are not simulated anymore, until woken up by the graph
+      (cf Graph::wake).
+    **/
+    bool asleep;
+    /** For how long (in sec) the kinetic energy of the node has been below
+      SLEEP_ENERGY.
+    **/
+    float calm_time;
+
     bool selected;
+
+    /** Value of the graph's activity clock when the node was last added,
+      selected or woken up from outside (cf Graph::enforceNodeBudget).
+    **/
+    unsigned int last_activity;
+
      /** The (minimum) amount of nodes that link me to the selected node.
-       If no node is selected, -1
+       If no node is selected, -1. Nodes farther than Graph::distanceCap()
+       (or not connected to the selection) are at distanceCap().
     **/
     int distance_to_selected;
+    /** True if the node is closer than Graph::distanceCap() to the selection.
+    **/
     bool distance_to_selected_updated;
 
     vec2f hookeForce;
@@ -75,31 +118,23 @@ public:
 
 
     const std::string& getID() const;
-    const std::string& getSafeID() const;
-
-    /**
-      Returns a vector of all nodes connected to myself.
-      */
-    std::vector<Node*> getConnectedNodes();
+    Symbol getIDSymbol() const {return id;}
 
-    bool isConnectedTo(Node* node);
-
-    /**
-      Returns a vector of all relations this node has with other nodes.
-      */
-    std::vector<NodeRelation>& getRelations();
+    /** True while the charge of the node decays, after it was tickled.
+    **/
+    bool isDecaying() const {return decaying;}
 
-    NodeRelation& addRelation(Node& to, const relation_type type, const std::string& label);
     /**
-      Returns a vector of all the relations of *this that link to node.
-      Returns an empty vector if no relation exist between *this and node.
+      Same as ID, with special chars removed (cf safeIdFilter()). Computed on
+      demand: only used to export the graph (cf Graph::saveToGraphViz).
       */
-    std::vector<const NodeRelation*> getRelationTo(Node& node) const;
+    std::string getSafeID() const;
 
     /**
-      executes one computation step to compute the position of the node according to other nodes.
+      Makes the node decay (ie, slowly come back to its base charge and
+      colour) for dt seconds.
       */
-    void step(Graph& g, float dt);
+    void updateDecay(float dt);
 
      /**
       Renders the node. If called with rendering mode 'SIMPLE', goes in simple mode.
@@ -107,7 +142,14 @@ public:
       In simple mode, no special effects are rendered. Useful for picking selected
       primitive in OpenGL GL_SELECT mode.
       */
-    void render(rendering_mode mode, OroView& env, bool debug = false);
+    void render(rendering_mode mode, OroView& env);
+
+    /**
+      Draws the Hooke (red) and Coulomb (green) forces applied to the node
+      at the last physics step. Needs the graph mutex: the physics thread
+      writes them.
+      */
+    void renderForces() const;
 
     void decay();
 
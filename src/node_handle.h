@@ -0,0 +1,31 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef NODE_HANDLE_H
+#define NODE_HANDLE_H
+
+#include "slot_map.h"
+
+/**
+  Stable reference to a node of the graph (cf Graph::getNode). Unlike a
+  pointer, it survives the insertion of other nodes, and tells when the node
+  does not exist anymore.
+  */
+typedef SlotHandle NodeHandle;
+
+#endif // NODE_HANDLE_H
@@ -21,7 +21,7 @@
 
 #include "node.h"
 
-NodeRelation::NodeRelation(Node* from, Node* to, const relation_type type, const std::string& label) :
+NodeRelation::NodeRelation(int from, int to, const relation_type type, Symbol label) :
 	from(from),
 	to(to),
 	type(type),
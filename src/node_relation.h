@@ -24,18 +24,21 @@
 #include "constants.h"
 
 #include "edge.h"
+#include "string_pool.h"
 
-class Node;
-
+/**
+  One relation of the graph, as read from the RelationTable. 'from' and 'to'
+  are the indices of the nodes (cf Node::index).
+  */
 class NodeRelation {
 
 public:
-	NodeRelation(Node* from, Node* to, const relation_type type, const std::string& label);
+	NodeRelation(int from, int to, const relation_type type, Symbol label);
 
-	Node* from;
-	Node* to;
+	int from;
+	int to;
 	relation_type type;
-	std::string label;
+	Symbol label;
 
 };
 
@@ -24,7 +24,7 @@
 
 using namespace std;
 
-NodeRenderer::NodeRenderer(int tagid, string label, node_type type) :
+NodeRenderer::NodeRenderer(int tagid, Symbol label, node_type type) :
     tagid(tagid),
     label(label),
     type(type),
@@ -33,48 +33,52 @@ NodeRenderer::NodeRenderer(int tagid, string label, node_type type) :
     selected(false),
     current_distance_to_selected(-1),
     base_size(NODE_SIZE),
-    base_fontsize(BASE_FONT_SIZE)
+    base_fontsize(BASE_FONT_SIZE),
+    icon(NULL)
 {
 
     size = base_size * 1.2;
     fontsize = base_fontsize;
 
-#ifndef TEXT_ONLY
     if (type == CLASS_NODE) {
         base_col = CLASSES_COLOUR;
-        icon = texturemanager.grab("classes.png");
+        icon_name = "classes.png";
     }
     else if (type == INSTANCE_NODE) {
         base_col = INSTANCES_COLOUR;
-        icon = texturemanager.grab("instances.png");
+        icon_name = "instances.png";
     }
     else if (type == LITERAL_NODE) {
         base_col = LITERALS_COLOUR;
-        icon = texturemanager.grab("literals.png");
+        icon_name = "literals.png";
     }
     else if (type == COMMENT_NODE) {
         base_col = LITERALS_COLOUR;
-        icon = texturemanager.grab("comment.png");
+        icon_name = "comment.png";
     }
     else if (type == TRUE_NODE) {
         base_col = vec4f(0.2, 1.0, 0.2, 1.0); //green
-        icon = texturemanager.grab("yes.png");
+        icon_name = "yes.png";
     }
     else if (type == FALSE_NODE) {
         base_col = vec4f(1.0, 0.2, 0.2, 1.0); //red
-        icon = texturemanager.grab("no.png");
+        icon_name = "no.png";
     }
     else {
         base_col = vec4f(1.0, 1.0, 1.0, 1.0);
-        icon = texturemanager.grab("instances.png");
+        icon_name = "instances.png";
     }
 
     col = base_col * 1.2;
-#endif
 
 
 }
 
+TextureResource* NodeRenderer::getIcon() {
+    if (icon == NULL) icon = texturemanager.grab(icon_name);
+    return icon;
+}
+
 void NodeRenderer::setColour(vec4f col) {
     base_col = col;
 }
@@ -153,7 +157,7 @@ void NodeRenderer::draw(const vec2f& pos, rendering_mode mode, OroView& env, int
         float halfsize = size * 0.5f;
         vec2f offsetpos = pos - vec2f(halfsize, halfsize);
 
-        env.graphvizGraph << " [label=\"" << label
+        env.graphvizGraph << " [label=\"" << label.str()
                           << "\", shape=box, height=0.2, "
                           << "pos=\"" << offsetpos.x << "," << offsetpos.y << "\"];\n";
         return;
@@ -171,7 +175,7 @@ void NodeRenderer::drawSimple(const vec2f& pos){
     glEnable(GL_BLEND);
     glEnable(GL_TEXTURE_2D);
 
-    float ratio = icon->h / (float) icon->w;
+    float ratio = getIcon()->h / (float) getIcon()->w;
     float halfsize = size * 0.5f;
     vec2f offsetpos = pos - vec2f(halfsize, halfsize);
 
@@ -223,7 +227,7 @@ void NodeRenderer::drawName(const vec2f& pos, FXFont& font){
     glLoadIdentity();
 
     font.setFontSize(fontsize);
-    font.draw(screenpos.x, screenpos.y, label);
+    font.draw(screenpos.x, screenpos.y, label.str());
 
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
@@ -268,7 +272,7 @@ void NodeRenderer::drawShadow(const vec2f& pos){
     glEnable(GL_BLEND);
     glEnable(GL_TEXTURE_2D);
 
-    float ratio = icon->h / (float) icon->w;
+    float ratio = getIcon()->h / (float) getIcon()->w;
     float halfsize = size * 0.5f;
     vec2f offsetpos = pos - vec2f(halfsize, halfsize) + SHADOW_OFFSET;;
 
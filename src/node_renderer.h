@@ -24,6 +24,7 @@
 #include "core/vectors.h"
 #include "core/texture.h"
 #include "zoomcamera.h"
+#include "string_pool.h"
 
 class OroView;
 
@@ -32,18 +33,21 @@ class NodeRenderer
 
     float idle_time;
 
-    std::string label;
+    Symbol label;
 
     int tagid;
 
     node_type type;
 
+    // The icon is only loaded when the node is first drawn: nodes can be
+    // created without any OpenGL context (cf oroview-layout).
+    const char* icon_name;
     TextureResource* icon;
 
     float getAlpha();
 
 
-    TextureResource* getIcon() { return icon; }
+    TextureResource* getIcon();
 
     bool hovered;
     bool selected;
@@ -65,7 +69,7 @@ class NodeRenderer
 
 
 public:
-    NodeRenderer(int tagid, std::string label, node_type type = CLASS_NODE);
+    NodeRenderer(int tagid, Symbol label, node_type type = CLASS_NODE);
 
     vec4f col;
     float size;
@@ -81,11 +85,22 @@ public:
     */
     void increment_idle_time(float dt);
 
+    /**
+    True while the node fades out, after having been idle (cf FADE_TIME).
+    */
+    bool isFading() const {return idle_time > 0.0 && idle_time < FADE_TIME;}
+
     void setMouseOver(bool over);
     void setSelected(bool selected);
     void setColour(vec4f col);
 
-    std::string getLabel() {return label;}
+    const std::string& getLabel() const {return label.str();}
+    Symbol getLabelSymbol() const {return label;}
+    node_type getType() const {return type;}
+
+    /** Hash value of the ID of the node: its name for OpenGL picking.
+    **/
+    int getTagID() const {return tagid;}
 
 
 
@@ -14,14 +14,14 @@
 #include <boost/foreach.hpp>
 #include <boost/variant.hpp>
 #include <boost/thread/locks.hpp>
-#include <boost/thread/mutex.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <liboro/oro_exceptions.h>
 
 #include "oro_connector.h"
 
-#include "oroview.h"
 #include "node_relation.h"
+#include "macros.h"
 
 
 using namespace std;
@@ -30,7 +30,8 @@ using namespace boost;
 
 OntologyConnector::OntologyConnector(const string& host, const string& port, bool only_labelled_nodes) :
     sc(host, port),
-    only_labelled_nodes(only_labelled_nodes)
+    only_labelled_nodes(only_labelled_nodes),
+    active_concepts_id(NULL)
 {
 
     oro = Ontology::createWithConnector(sc);
@@ -39,6 +40,11 @@ OntologyConnector::OntologyConnector(const string& host, const string& port, boo
     oro::Class("ActiveConcept").onNewInstance(*this);
 }
 
+OntologyConnector::~OntologyConnector()
+{
+    delete active_concepts_id.exchange(NULL);
+}
+
 const string OntologyConnector::getEdgeLabel(relation_type type, const string& original_label)
 {
     switch(type) {
@@ -50,8 +56,19 @@ const string OntologyConnector::getEdgeLabel(relation_type type, const string& o
         case COMMENT:
             return "";
 
-        default:
-            return oro->getLabel(original_label);
+        default: {
+            // Every resource shares the same few predicates: each label is
+            // only asked once.
+            boost::lock_guard<boost::mutex> l(oro_mutex);
+
+            map<string, string>::const_iterator it = edge_labels.find(original_label);
+            if (it != edge_labels.end()) return it->second;
+
+            string label = oro->getLabel(original_label);
+            edge_labels[original_label] = label;
+
+            return label;
+        }
     }
 }
 
@@ -64,33 +81,42 @@ void OntologyConnector::operator()(const OroEvent& evt)
     copy(evt_content.begin(), evt_content.end(), ostream_iterator<Concept>(cout, "\n"));
     #endif
 
-    lock_guard<mutex> l(active_concept_mutex);
-
-    active_concepts_id.clear();
+    set<string>* concepts = new set<string>();
 
     BOOST_FOREACH(Concept c, evt_content) {
         string id = c.id();
-        active_concepts_id.insert(id);
+        concepts->insert(id);
     }
 
+    // Replaces the concepts that have not been popped yet
+    delete active_concepts_id.exchange(concepts);
+
 }
 
 const set<string> OntologyConnector::popActiveConceptsId()
 {
-    lock_guard<mutex> l(active_concept_mutex);
+    set<string>* concepts = active_concepts_id.exchange(NULL);
 
-    set<string> res = active_concepts_id;
-    active_concepts_id.clear();
+    if (!concepts) return set<string>();
+
+    set<string> res;
+    res.swap(*concepts);
+    delete concepts;
 
     return res;
 }
 
 bool OntologyConnector::addNode(const string& id, Graph& g) {
 
-    string label = oro->getLabel(id);
-    string type = oro->lookup(id)[id];
+    string label;
+    string type;
+    {
+        boost::lock_guard<boost::mutex> l(oro_mutex);
+        label = oro->getLabel(id);
+        type = oro->lookup(id)[id];
+    }
 
-    node_type ntype;
+    node_type ntype = INSTANCE_NODE;
 
     if (type == "INSTANCE") ntype = INSTANCE_NODE;
     else if (type == "CLASS") ntype = CLASS_NODE;
@@ -106,52 +132,69 @@ bool OntologyConnector::addNode(const string& id, Graph& g) {
 
     TRACE("Adding node " << id << " of type " << type << " with label " << label);
 
-    g.addNode(id, label, NULL, ntype);
+    g.addNode(id, label, NodeHandle(), ntype);
 
     return true;
 }
 
-void OntologyConnector::walkThroughOntology(const string& from_node, int depth, OroView* graph) {
+void OntologyConnector::walkThroughOntology(const string& from_node, int depth, Graph& graph) {
 
     if (depth == 0) return;
 
+    // Distances to the selection are updated once, at the end of the walk
+    Graph::Batch batch(graph);
+
+    ResourceDetails details;
+    if (!fetch(from_node, details)) return;
+
+    vector<string> linked;
+    addResource(details, graph, linked);
+
+    BOOST_FOREACH(const string& id, linked) {
+        walkThroughOntology(id, depth - 1, graph);
+    }
+}
+
+bool OntologyConnector::fetch(const string& id, ResourceDetails& details) {
+
     //We need a collate object to compute hashes of literals
     locale loc;                 // the "C" locale
     const collate<char>& coll = use_facet<collate<char> >(loc);
 
-    string details;
-    string id;
-    vec4f color;
+    string raw_details;
 
     try {
-        oro->getResourceDetails(from_node, details);
+        boost::lock_guard<boost::mutex> l(oro_mutex);
+        oro->getResourceDetails(id, raw_details);
     }
     catch (ResourceNotFoundOntologyException& e) {
-        cerr << "Node " + from_node + " not found in the ontology. Continuing." << endl;
-        return;
+        cerr << "Node " + id + " not found in the ontology. Continuing." << endl;
+        return false;
     }
 
     Json::Value root;   // will contains the root value after parsing.
     Json::Reader reader;
-    bool parsingSuccessful = reader.parse( details, root );
+    bool parsingSuccessful = reader.parse( raw_details, root );
     if ( !parsingSuccessful )
     {
         // report to the user the failure and their locations in the document.
-        cerr  << "Failed to parse configuration\n"
+        cerr  << "Failed to parse the details of " << id << "\n"
                    << reader.getFormatedErrorMessages();
-        return;
+        return false;
     }
 
-    string name = root.get("name", "NO_NAME").asString();
+    details.id = id;
+    details.label = root.get("name", id).asString();
 
     string type = root.get("type", "NO_TYPE").asString();
+    details.type = boost::iequals(type, "class") ? CLASS_NODE : INSTANCE_NODE;
+
+    details.aliases.clear();
+    details.links.clear();
 
     const Json::Value sameAs = root["sameAs"]; // list of id of nodes that are aliases
     for ( int index = 0; index < sameAs.size(); ++index ) {
-        if (sameAs[index].asString() != from_node) {
-            TRACE("Adding " << sameAs[index].asString() << " as alias for " << from_node);
-            graph->addAlias(sameAs[index].asString(), from_node);
-        }
+        if (sameAs[index].asString() != id) details.aliases.push_back(sameAs[index].asString());
     }
 
     const Json::Value attributes = root["attributes"];
@@ -169,31 +212,62 @@ void OntologyConnector::walkThroughOntology(const string& from_node, int depth,
         else if (oroType == "Classes") {type = CLASS;}
         else if (oroType == "comment") {type = COMMENT;}
 
+        string edge_label = getEdgeLabel(type, oroType);
+
         for ( int index = 0; index < values.size(); ++index ) { // Iterates over the sequence elements.
 
-            string to_label = values[index]["name"].asString();
-            string to_id = values[index]["id"].asString();
-            
-            if (to_id == "literal") { //build a hash for each literal based on "full name": current node + predicate + literal value
-                string full_name = from_node + oroType + to_label;
+            ResourceDetails::Link link;
+            link.label = values[index]["name"].asString();
+            link.id = values[index]["id"].asString();
+            link.type = type;
+            link.edge_label = edge_label;
+
+            if (link.id == "literal") { //build a hash for each literal based on "full name": current node + predicate + literal value
+                string full_name = id + oroType + link.label;
                 ostringstream o;
                 o << "literal_" << coll.hash(full_name.data(),full_name.data()+full_name.length());
-                to_id = o.str();
+                link.id = o.str();
             }
 
-            if (graph->addNodeConnectedTo(
-                    to_id,
-                    to_label,
-                    from_node,
-                    type,
-                    getEdgeLabel(type, oroType)))
-            {
-                walkThroughOntology(to_id,
-                                    depth - 1,
-                                    graph);
-            }
+            details.links.push_back(link);
         }
     }
 
+    return true;
 }
 
+bool OntologyConnector::addResource(const ResourceDetails& details, Graph& graph, vector<string>& linked) {
+
+    if (graph.findHandle(details.id).isNull()) {
+
+        if (only_labelled_nodes &&
+            details.type == CLASS_NODE &&
+            details.label == details.id) {
+
+            TRACE("Node " << details.id << " has not label, discarding it.");
+            return false;
+        }
+
+        graph.addNode(details.id, details.label, NodeHandle(), details.type);
+    }
+
+    BOOST_FOREACH(const string& alias, details.aliases) {
+        TRACE("Adding " << alias << " as alias for " << details.id);
+        graph.addAlias(alias, details.id);
+    }
+
+    BOOST_FOREACH(const ResourceDetails::Link& link, details.links) {
+        if (graph.addNodeConnectedTo(
+                link.id,
+                link.label,
+                details.id,
+                link.type,
+                link.edge_label,
+                only_labelled_nodes))
+        {
+            linked.push_back(link.id);
+        }
+    }
+
+    return true;
+}
@@ -19,7 +19,10 @@
 #define ORO_CONNECTOR_H
 
 #include <set>
+#include <map>
+#include <vector>
 #include <string>
+#include <atomic>
 
 #include <boost/thread/mutex.hpp>
 
@@ -29,12 +32,32 @@
 #include "constants.h"
 #include "graph.h"
 
-class OroView;
+/**
+  A resource of the ontology, as described by the server, once parsed: its
+  label and type, its aliases, and the resources it is linked to.
+  */
+struct ResourceDetails {
+
+    struct Link {
+        std::string id;
+        std::string label;
+        relation_type type;
+        std::string edge_label;
+    };
+
+    std::string id;
+    std::string label;
+    node_type type;
+
+    std::vector<std::string> aliases;
+    std::vector<Link> links;
+};
 
 class OntologyConnector : public oro::OroEventObserver {
 
 public:
     OntologyConnector(const std::string& host, const std::string& port, bool only_labelled_nodes = false);
+    ~OntologyConnector();
 
     /**
       Adds a node to the graph, querying the ontology for its type and label.
@@ -43,7 +66,33 @@ public:
       node has no label and only_labelled_node is true.
     */
     bool addNode(const std::string& id, Graph& g);
-    void walkThroughOntology(const std::string& from_node, int depth, OroView* graph);
+
+    /**
+      Adds the resource and its neighbours, up to 'depth' edges away, to the
+      graph. Blocks until every resource has been fetched: the main loop
+      uses IngestionPipeline instead.
+      */
+    void walkThroughOntology(const std::string& from_node, int depth, Graph& graph);
+
+    /**
+      Queries the ontology for the details of a resource, and parses them.
+      Does not touch the graph: can be called from any thread.
+
+      @return false if the resource is not found, or its details can not be
+      parsed.
+    */
+    bool fetch(const std::string& id, ResourceDetails& details);
+
+    /**
+      Adds a fetched resource (if not there yet), its aliases and its links
+      to the graph. The ids of the linked nodes that have been added (or
+      were already there) are appended to 'linked': they are the next ones
+      to walk through.
+
+      @return false if the resource has been discarded (cf
+      only_labelled_nodes).
+    */
+    bool addResource(const ResourceDetails& details, Graph& graph, std::vector<std::string>& linked);
 
     const std::set<std::string> popActiveConceptsId();
 
@@ -53,11 +102,23 @@ private:
 
     bool only_labelled_nodes;
 
-    std::set<std::string> active_concepts_id;
+    /**
+      Latest active concepts, not popped yet (or NULL). Exchanged atomically
+      between the liboro event thread and the main loop: neither waits for
+      the other.
+      */
+    std::atomic<std::set<std::string>*> active_concepts_id;
     oro::Ontology *oro;
     oro::SocketConnector sc;
 
-    mutable boost::mutex active_concept_mutex;
+    /**
+      The connection to the server is shared by every thread: requests go
+      through it one at a time.
+      */
+    boost::mutex oro_mutex;
+
+    // Labels of the predicates, by id (cf getEdgeLabel). Needs oro_mutex.
+    std::map<std::string, std::string> edge_labels;
 
     const std::string getEdgeLabel(relation_type type, const std::string& original_label);
 };
@@ -20,6 +20,7 @@
 
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/thread/locks.hpp>
 
 #include <json/json.h>
 
@@ -36,13 +37,20 @@ using namespace std;
 
 OroView::OroView(const Json::Value& config):
     config(config),
+    physics(g),
+    pending_decay(0.0),
+    quiet_time(0.0),
+    since_redraw(0.0),
+    input_received(false),
     display_shadows(config.get("shadows", "true").asBool()),
     display_labels(config.get("display_labels", "true").asBool()),
     display_footer(config.get("display_footer", "true").asBool()),
     only_labelled_nodes(config.get("only_labelled_nodes", "false").asBool()),
     oro(config.get("oro_host", "localhost").asString(),
         config.get("oro_port", "6969").asString(),
-        only_labelled_nodes)
+        only_labelled_nodes),
+    ingestion(oro),
+    ingestion_budget(config.get("ingestion_budget", DEFAULT_INGESTION_BUDGET).asDouble())
 {
 
 
@@ -55,11 +63,9 @@ OroView::OroView(const Json::Value& config):
 
     currtime = time(NULL);
 
-    srand(currtime);
-
     //Nodes & users
 
-    hoverNode = NULL;
+    hoverNode = NodeHandle();
 
     track_users = false;
     selectedUser = NULL;
@@ -78,6 +84,7 @@ OroView::OroView(const Json::Value& config):
     display_node_infos = true;
     debug = false;
     advanced_debug = false;
+    memory_refresh = 0.0;
     paused = false;
 
     fontlarge = fontmanager.grab("Aller_Bd.ttf", LARGE_FONT_SIZE);
@@ -104,6 +111,10 @@ OroView::OroView(const Json::Value& config):
     stylesSetup(config);
     physicsSetup(config);
 
+    //with a fixed seed, the same graph always gets the same layout
+    g.seed(RANDOM_SEED != 0 ? RANDOM_SEED : currtime);
+    cout << "Random seed: " << g.random().getSeed() << endl;
+
     background_colour = BACKGROUND_COLOUR.truncate();
 }
 
@@ -135,29 +146,6 @@ void OroView::stylesSetup(const Json::Value& config) {
     }
 
 
-}
-
-void OroView::physicsSetup(const Json::Value& config) {
-
-    Json::Value physics = config["physics"];
-
-    if (physics == Json::nullValue) return; // Uses defaults, as specified in constants.h
-
-    cout << "Setting customs physics parameters from config file." << endl;
-    if (physics["mass"] != Json::nullValue) {
-        INITIAL_MASS = physics["mass"].asDouble();
-    }
-    if (physics["damping"] != Json::nullValue) {
-        INITIAL_DAMPING = physics["damping"].asDouble();
-    }
-    if (physics["repulsion"] != Json::nullValue) {
-        COULOMB_CONSTANT = physics["repulsion"].asDouble();
-    }
-    if (physics["maxspeed"] != Json::nullValue) {
-        MAX_SPEED = physics["maxspeed"].asDouble();
-    }
-
-
 }
 
 vec4f OroView::convertRGBA2Float(const Json::Value& color) {
@@ -172,19 +160,46 @@ void OroView::init(){
 
     TRACE("*** Initialization ***");
 
-    string root = config.get("initial_concept", ROOT_CONCEPT).asString();
+    // Instant start from a graph snapshot, if any
+    string snapshot_file = config.get("load_snapshot", "").asString();
+
+    if (!snapshot_file.empty() && g.loadSnapshot(snapshot_file)) {
+        cout << g.nodesCount() << " nodes loaded from graph snapshot " << snapshot_file << endl;
+    }
+    else {
+        string root = config.get("initial_concept", ROOT_CONCEPT).asString();
+
+        oro.addNode(root, g);
+        TRACE("Starting with concept " << root);
+
+        oro.walkThroughOntology(root, 2, g);
 
-    oro.addNode(root, g);
-    TRACE("Starting with concept " << root);
+        TRACE("*** Graph created and populated ***");
 
-    oro.walkThroughOntology(root, 2, this);
+        // Warm start from a layout precomputed by oroview-layout, if any
+        int cached = 0;
+        string layout_file = config.get("layout_cache", "").asString();
 
-    TRACE("*** Graph created and populated ***");
+        if (!layout_file.empty()) {
+            LayoutCache cache;
+            if (cache.load(layout_file)) {
+                cached = g.applyLayout(cache);
+                cout << cached << " of " << g.nodesCount() << " nodes placed from layout cache " << layout_file << endl;
+            }
+        }
+
+        if (MULTILEVEL_LAYOUT && cached == 0) g.computeInitialLayout();
+    }
+
+    physics.start(PHYSICS_TICK_RATE);
+    ingestion.start(config.get("ingestion_threads", DEFAULT_INGESTION_THREADS).asInt());
     TRACE("*** STARTING MAIN LOOP ***");
 }
 
 /** Events */
 void OroView::keyPress(SDL_KeyboardEvent *e) {
+    input_received = true;
+
     if (e->type == SDL_KEYUP) return;
 
     if (e->type == SDL_KEYDOWN) {
@@ -206,16 +221,21 @@ void OroView::keyPress(SDL_KeyboardEvent *e) {
         //        }
 
         if (e->keysym.sym == SDLK_SPACE) {
+            boost::lock_guard<boost::mutex> l(g.getMutex());
             //addRandomNodes(2, 2);
             updateCurrentNode();
         }
 
         if (e->keysym.sym == SDLK_t) {
-            g.getRandomNode().tickle();
+            boost::lock_guard<boost::mutex> l(g.getMutex());
+            Node& node = g.getRandomNode();
+            node.tickle();
+            g.wake(node);
         }
 
         if (e->keysym.sym == SDLK_p) {
             paused = !paused;
+            physics.setPaused(paused);
         }
 
         if(e->keysym.sym == SDLK_UP) {
@@ -229,10 +249,46 @@ void OroView::keyPress(SDL_KeyboardEvent *e) {
         if(e->keysym.sym == SDLK_s) {
             g.saveToGraphViz(*this);
         }
+
+        if(e->keysym.sym == SDLK_b) {
+            boost::lock_guard<boost::mutex> l(g.getMutex());
+            try {
+                g.saveSnapshot("ontology.snapshot");
+            }
+            catch(OroViewException& exception) {
+                cerr << exception.what() << endl;
+            }
+        }
+
+        if(e->keysym.sym == SDLK_m) {
+            boost::lock_guard<boost::mutex> l(g.getMutex());
+            updateMemoryUsage();
+            try {
+                memory_usage.save("memory.json");
+            }
+            catch(OroViewException& exception) {
+                cerr << exception.what() << endl;
+            }
+        }
     }
 }
 
+/** Needs the graph mutex */
+void OroView::updateMemoryUsage() {
+    memory_usage = MemoryUsage();
+
+    g.memoryUsage(memory_usage);
+
+    memory_usage.add("textures", texturemanager.memoryUsage());
+    memory_usage.add("font glyphs", fontmanager.memoryUsage());
+
+    memory_usage.count("textures", texturemanager.texturesCount());
+    memory_usage.count("fonts", fontmanager.fontsCount());
+    memory_usage.count("font glyphs", fontmanager.glyphsCount());
+}
+
 void OroView::mouseClick(SDL_MouseButtonEvent *e) {
+    input_received = true;
 
     if(e->type == SDL_MOUSEBUTTONUP) {
 
@@ -282,6 +338,7 @@ void OroView::mouseClick(SDL_MouseButtonEvent *e) {
 }
 
 void OroView::mouseMove(SDL_MouseMotionEvent *e) {
+    input_received = true;
 
     mousepos = vec2f(e->x, e->y);
 
@@ -290,7 +347,9 @@ void OroView::mouseMove(SDL_MouseMotionEvent *e) {
     //move camera in direction the user dragged the mouse
     if(mousedragged) {
         if (selectedNode != NULL) {
+            boost::lock_guard<boost::mutex> l(g.getMutex());
             selectedNode->pos += vec2f( e->xrel, e->yrel )/2;
+            g.wake(*selectedNode);
         }
         else backgroundPos += vec2f( e->xrel, e->yrel );
 
@@ -304,7 +363,11 @@ void OroView::mouseMove(SDL_MouseMotionEvent *e) {
     mousemoved=true;
 }
 
-/** main update function */
+/** main update function
+
+  Only deals with events and rendering: the physics runs in its own thread
+  (cf PhysicsThread), and never holds back a frame.
+*/
 void OroView::update(float t, float dt) {
 
     SDL_Delay(20); //N'allons pas trop vite au début...
@@ -322,6 +385,26 @@ void OroView::update(float t, float dt) {
 
     logic_time = SDL_GetTicks() - logic_time;
 
+    // The displayed date shows the seconds: it changes once per second.
+    bool clock_ticked = updateClock();
+
+    // Once the physics is at rest and nothing else moves, the scene does not
+    // change anymore: do not redraw it. Any input resumes the drawing.
+    bool animated = input_received || camera.isMoving() || debug || draw_loading ||
+                    !(paused || g.isAtRest()) || g.isFading() ||
+                    !footer_content.empty() || clock_ticked;
+
+    input_received = false;
+    quiet_time = animated ? 0.0 : quiet_time + dt;
+    since_redraw += dt;
+
+    // Even when nothing moves, the scene is refreshed from time to time (the
+    // window may have been uncovered in the meantime).
+    redraw = quiet_time < REDRAW_DELAY || since_redraw >= MAX_REDRAW_INTERVAL;
+    if (!redraw) return;
+
+    since_redraw = 0.0;
+
     draw_time = SDL_GetTicks();
 
     draw(runtime, dt);
@@ -329,6 +412,18 @@ void OroView::update(float t, float dt) {
     framecount++;
 }
 
+bool OroView::updateClock() {
+    time_t now = time(NULL);
+    if (now == currtime) return false;
+
+    currtime = now;
+
+    string previous_date = displaydate;
+    updateTime();
+
+    return displaydate != previous_date;
+}
+
 void OroView::updateTime() {
     //display date
     char datestr[256];
@@ -347,6 +442,8 @@ void OroView::updateTime() {
 void OroView::logic(float t, float dt) {
     if(draw_loading && logic_time > 1000) draw_loading = false;
 
+    g.interpolate(physics.interpolationFactor());
+
     //still want to update camera while paused
     if(paused) {
         updateCamera(dt);
@@ -363,22 +460,54 @@ void OroView::logic(float t, float dt) {
         }
     }
 
-    BOOST_FOREACH(string id, oro.popActiveConceptsId()) {
+    set<string> active_concepts = oro.popActiveConceptsId();
+
+    // Modifications of the graph must wait for the end of the current physics step
+    boost::unique_lock<boost::mutex> lock(g.getMutex(), boost::defer_lock);
+    if (!active_concepts.empty() || ingestion.ready()) lock.lock();
+
+    BOOST_FOREACH(string id, active_concepts) {
         try {
-            g.getNode(id).tickle();
+            Node& node = g.getNode(id);
+            node.tickle();
+            g.wake(node);
             queueNodeInFooter(id);
         }
         catch(OroViewException& exception) {
-            cout << "One of the active concept do not exist yet: " << id << ". Creating it." << endl;
-            oro.addNode(id, g);
-            g.getNode(id).tickle();
-            queueNodeInFooter(id);
-            oro.walkThroughOntology(id, 1, this);
+            cout << "One of the active concept do not exist yet: " << id << ". Fetching it." << endl;
+            // Tickled once added (see below)
+            ingestion.request(id, 1, true);
+        }
+    }
 
+    // Decaying modifies the charge of the nodes, and thus needs the graph.
+    // If a physics step is running, the decay is postponed to a later frame.
+    pending_decay += dt;
+    if (lock.owns_lock() || lock.try_lock()) {
+        // Resources fetched from the ontology in the background
+        vector<string> activated;
+        ingestion.ingest(g, ingestion_budget, activated);
+
+        BOOST_FOREACH(const string& id, activated) {
+            Node& node = g.getNode(id);
+            node.tickle();
+            g.wake(node);
+            queueNodeInFooter(id);
         }
+
+        g.decay(pending_decay);
+        pending_decay = 0.0;
+
+        // Long running sessions: the least recently used nodes are removed
+        if (g.enforceNodeBudget() > 0 && g.findNode(hoverNode) == NULL)
+            hoverNode = NodeHandle();
+
+        // New nodes can be picked before the next physics step
+        g.publishTopology();
     }
+    if (lock.owns_lock()) lock.unlock();
 
-    g.step(dt);
+    g.updateRenderers(dt);
 
     updateCamera(dt);
 }
@@ -426,7 +555,7 @@ void OroView::mouseTrace(Frustum& frustum, float dt) {
     mouse_hits = glRenderMode(GL_RENDER);
     /** End of selection **/
 
-    Node* nodeSelection = NULL;
+    NodeHandle nodeSelection;
     //    RUser* userSelection = 0;
 
     if (mouse_hits > 0) {
@@ -454,7 +583,7 @@ void OroView::mouseTrace(Frustum& frustum, float dt) {
     glDisable(GL_DEPTH_TEST);
 
     // is over a file
-    if(nodeSelection != NULL) {
+    if(!nodeSelection.isNull()) {
         //	// un hover a user
         //	if(hoverUser != 0) {
         //	    hoverUser->setMouseOver(false);
@@ -463,10 +592,11 @@ void OroView::mouseTrace(Frustum& frustum, float dt) {
 
         if(nodeSelection != hoverNode) {
             //deselect previous selection
-            if(hoverNode !=NULL) hoverNode->renderer.setMouseOver(false);
+            Node* previous = g.findNode(hoverNode);
+            if(previous != NULL) previous->renderer.setMouseOver(false);
 
             //select new
-            nodeSelection->renderer.setMouseOver(true);
+            g.getNode(nodeSelection).renderer.setMouseOver(true);
             hoverNode = nodeSelection;
         }
         //    } // is over a user
@@ -487,21 +617,26 @@ void OroView::mouseTrace(Frustum& frustum, float dt) {
         //	}
     }
     else {
-        if(hoverNode!=NULL) hoverNode->renderer.setMouseOver(false);
+        Node* previous = g.findNode(hoverNode);
+        if(previous != NULL) previous->renderer.setMouseOver(false);
         //	if(hoverUser!=0) hoverUser->setMouseOver(false);
-        hoverNode=NULL;
+        hoverNode = NodeHandle();
         //	hoverUser=0;
     }
 
+    // Selection modifies the graph
+    boost::unique_lock<boost::mutex> lock(g.getMutex(), boost::defer_lock);
+    if(mouseleftclicked || mouserightclicked) lock.lock();
+
     if(mouseleftclicked) {
         mousedragged=true;
-        if(hoverNode!=NULL) selectNode(hoverNode);
+        if(!hoverNode.isNull()) selectNode(hoverNode);
         //	else if(hoverUser!=0) selectUser(hoverUser);
         else selectBackground();
     }
 
     if(mouserightclicked) {
-        if(hoverNode!=NULL) addSelectedNode(hoverNode);
+        if(!hoverNode.isNull()) addSelectedNode(hoverNode);
     }
 }
 
@@ -541,21 +676,21 @@ void OroView::draw(float t, float dt) {
     glEnable(GL_BLEND);
 
     //Draw shadows for edges and then nodes
-    if (display_shadows) g.render(SHADOWS, *this, advanced_debug);
+    if (display_shadows) g.render(SHADOWS, *this);
 
     //Draw edges and then nodes
     glBindTexture(GL_TEXTURE_2D, beamtex->textureid);
-    g.render(NORMAL, *this, advanced_debug);
+    g.render(NORMAL, *this);
 
     //draw 'gourceian blur' around dirnodes
     glBlendFunc (GL_ONE, GL_ONE);
     glBindTexture(GL_TEXTURE_2D, bloomtex->textureid);
     //Draw Bloom
-    g.render(BLOOM, *this, advanced_debug);
+    g.render(BLOOM, *this);
     glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     //Draw names
-    if (display_labels) g.render(NAMES, *this, advanced_debug);
+    if (display_labels) g.render(NAMES, *this);
 
     //displayCoulombField(); //doesn't work?
 
@@ -593,6 +728,10 @@ void OroView::draw(float t, float dt) {
 
         track_users ? usersBounds.draw() : nodesBounds.draw();
 
+        // The forces are written by the physics thread: wait for the end of
+        // the current physics step.
+        boost::lock_guard<boost::mutex> l(g.getMutex());
+        g.renderForces();
     }
 
     //gGourceQuadTreeDebug
@@ -619,6 +758,10 @@ void OroView::draw(float t, float dt) {
     fontmedium.draw(display.width/2 - date_x_offset, 20, displaydate);
 
     if(debug) {
+        // The physical state of the nodes is read from the graph: wait for
+        // the end of the current physics step.
+        boost::lock_guard<boost::mutex> l(g.getMutex());
+
         vec3f campos = camera.getPos();
 
         glDisable(GL_TEXTURE_2D);
@@ -628,25 +771,54 @@ void OroView::draw(float t, float dt) {
 
         font.print(0,20, "FPS: %.2f", fps);
         font.print(0,40,"Time Scale: %.2f", time_scale);
-        //        font.print(0,60,"Users: %d", users.size());
-        font.print(0,80,"Nodes: %d", g.nodesCount());
-        font.print(0,100,"Edges: %d", g.edgesCount());
+        font.print(0,60,"Physics: %d threads, %s kernels", g.threadsCount(), g.kernelsName());
+        font.print(0,80,"Nodes: %d (%d awake, %d stepped)", g.nodesCount(), g.activeNodesCount(), g.steppedNodesCount());
+        font.print(0,100,"Edges: %d - Ontology: %d resources pending", g.edgesCount(), ingestion.pendingCount());
+        if (LAYOUT_SOLVER == STRESS_SOLVER)
+            font.print(0,120,"Solver: sparse stress majorization (%d pivots)", STRESS_PIVOTS);
+        else if (REPULSION_ENGINE == BARNES_HUT_ENGINE)
+            font.print(0,120,"Repulsion: Barnes-Hut (theta=%.2f)", BARNES_HUT_THETA);
+        else if (REPULSION_ENGINE == GRID_ENGINE)
+            font.print(0,120,"Repulsion: grid (cutoff=%.0f)", GRID_CUTOFF);
+        else
+            font.print(0,120,"Repulsion: exact");
 
         font.print(0,140,"Camera: (%.2f, %.2f, %.2f)", campos.x, campos.y, campos.z);
         font.print(0,160,"Gravity: %.2f", GRAVITY);
-        font.print(0,180,"Logic Time: %u ms", logic_time);
+        if (LAYOUT_SOLVER == STRESS_SOLVER)
+            font.print(0,180,"Logic Time: %u ms (physics step: %.1f ms) - Stress: %.4f%s", logic_time, physics.stepTime(),
+                       g.stress(), g.isAtRest() ? " (at rest)" : "");
+        else
+            font.print(0,180,"Logic Time: %u ms (physics step: %.1f ms) - Energy: %.1f%s", logic_time, physics.stepTime(),
+                       g.totalEnergy(), g.isAtRest() ? " (at rest)" : "");
         font.print(0,200,"Mouse Trace: %u ms", trace_time);
         font.print(0,220,"Draw Time: %u ms", SDL_GetTicks() - draw_time);
 
-        if(hoverNode != NULL) {
-            font.print(0,260,"Node %s:", hoverNode->getID().c_str());
-            font.print(30,280,"Speed: (%.2f, %.2f)", hoverNode->speed.x, hoverNode->speed.y);
-            font.print(30,300,"Charge: %.2f", hoverNode->charge);
-            font.print(30,320,"Kinetic energy: %.2f", hoverNode->kinetic_energy);
-            font.print(30,340,"Number of relations: %d", hoverNode->getRelations().size());
+        memory_refresh -= dt;
+        if (memory_refresh <= 0.0) {
+            updateMemoryUsage();
+            memory_refresh = 1.0;
+        }
+
+        font.print(0,240,"Memory: %.1f MB", memory_usage.total() / 1048576.0);
+
+        int line = 20;
+        BOOST_FOREACH(const MemoryUsage::Entries::value_type& entry, memory_usage.subsystems()) {
+            font.print(display.width - 260, line, "%s: %.2f MB", entry.first.c_str(), entry.second / 1048576.0);
+            line += 20;
+        }
+
+        Node* hovered = g.findNode(hoverNode);
+
+        if(hovered != NULL) {
+            font.print(0,260,"Node %s:", hovered->getID().c_str());
+            font.print(30,280,"Speed: (%.2f, %.2f)", hovered->speed.x, hovered->speed.y);
+            font.print(30,300,"Charge: %.2f", hovered->charge);
+            font.print(30,320,"Kinetic energy: %.2f", hovered->kinetic_energy);
+            font.print(30,340,"Number of relations: %d", g.getRelations().outgoing().degree(hovered->index));
             font.print(30,360,"Distance to closest selected node (%s): %d",
                        (selectedNode == NULL) ? "N/A" : selectedNode->getID().c_str(),
-                        hoverNode->distance_to_selected);
+                        hovered->distance_to_selected);
         }
 
     }
@@ -797,7 +969,7 @@ void OroView::updateCamera(float dt) {
         vec3f camerapos = camera.getPos();
 
         //	if(selectedUser !=NULL) focusbounds.update(selectedUser->getPos());
-        if(selectedNode !=NULL) focusbounds.update(selectedNode->pos);
+        if(selectedNode !=NULL) focusbounds.update(selectedNode->render_pos);
 
         camera.adjust(focusbounds);
     } else {
@@ -867,9 +1039,9 @@ void OroView::selectBackground() {
 
 /** Nodes */
 //select a node, deselect current node
-void OroView::selectNode(Node* node) {
+void OroView::selectNode(NodeHandle node) {
 
-    if (node->selected) return;
+    if (g.getNode(node).selected) return;
 
     backgroundSelected=false;
 
@@ -877,116 +1049,22 @@ void OroView::selectNode(Node* node) {
     g.select(node);
 
 
-    queueNodeInFooter(node->getID());
+    queueNodeInFooter(g.getNode(node).getID());
     updateCurrentNode();
 }
 
 //select a node, keep currently selected node
-void OroView::addSelectedNode(Node* node) {
+void OroView::addSelectedNode(NodeHandle node) {
 
     backgroundSelected=false;
 
-    if (node->selected) g.deselect(node);
+    if (g.getNode(node).selected) g.deselect(node);
     else {
         g.select(node);
-        queueNodeInFooter(node->getID());
+        queueNodeInFooter(g.getNode(node).getID());
     }
 }
 
-void OroView::addAlias(const string& alias, const string& id) {
-    g.addAlias(alias, id);
-}
-
-//Add node
-bool OroView::addNodeConnectedTo(const string& id,
-                                 const string& node_label,
-                                 const string& to,
-                                 relation_type type,
-                                 const string& edge_label){
-
-    Node* n;
-    Node* neighbour;
-
-    string label = node_label;
-
-    try {
-        neighbour = &g.getNode(to);
-    }
-    catch(OroViewException& exception) {
-        //neighbour not found, create it.
-        TRACE("Neighbour " << to << " not found. Creating it.");
-
-        addNodeConnectedTo(to, to, ROOT_CONCEPT, UNDEFINED, "");
-        neighbour = &g.getNode(to);
-    }
-
-    try {
-        //does the node already exists?
-
-        //if yes, reuse it
-        n = &g.getNode(id);
-    }
-    catch(OroViewException& exception) {
-        //if not, create it, create it.
-        TRACE("Not existing myself (" << id << "). Creating myself.");
-
-        node_type ntype;
-
-        //guess the type of the node we are adding
-        switch (type) {
-        case SUBCLASS:
-        case SUPERCLASS:
-        case CLASS:
-            ntype = CLASS_NODE;
-            break;
-
-        case INSTANCE:
-            ntype = INSTANCE_NODE;
-            break;
-
-        case PROPERTY:
-        case OBJ_PROPERTY:
-        case DATA_PROPERTY:
-            if (boost::starts_with(id, "literal")) {
-                if (node_label == "true"){
-                    ntype = TRUE_NODE;
-                    label = "";
-                }
-                else if (node_label == "false"){
-                    ntype = FALSE_NODE;
-                    label = "";
-                }
-                else ntype = LITERAL_NODE;
-
-            }
-            else ntype = INSTANCE_NODE;
-            break;
-
-        case COMMENT:
-            ntype = COMMENT_NODE;
-            break;
-
-        default:
-            TRACE("Default type of node? strange...");
-            ntype = INSTANCE_NODE;
-        }
-
-        if (only_labelled_nodes &&
-            ntype == CLASS_NODE &&
-            label == id) { //no a very robust way to check if a node has a label, but it's fast
-
-            TRACE("Node " << id << " has no label, discarding it.");
-            return false;
-        }
-
-        n = &g.addNode(id, label, neighbour, ntype);
-    }
-
-    g.addEdge(*n, *neighbour, type, edge_label);
-
-    return true;
-}
-
 Node& OroView::getNode(const std::string &id) {
     return g.getNode(id);
 }
@@ -996,7 +1074,7 @@ void OroView::updateCurrentNode() {
 
     if (selectedNode != NULL) {
         TRACE("Updating node " << selectedNode->getID());
-        oro.walkThroughOntology(selectedNode->getID(), 1, this);
+        ingestion.request(selectedNode->getID(), 1);
     }
     else cerr << "Select only one node to expand it." << endl;
 }
@@ -1006,6 +1084,8 @@ void OroView::addRandomNodes(int amount,int nb_rel) {
 
     const int length = 6; //length of randomly created ID.
 
+    Graph::Batch batch(g);
+
     for (int i = 0; i < amount ; ++i) {
 
         string newId;
@@ -1013,21 +1093,25 @@ void OroView::addRandomNodes(int amount,int nb_rel) {
         //Generate a new random id for this node
         for(int j=0; j<length; ++j)
         {
-            newId += (char)(rand() % 26 + 97); //ASCII codes of letters starts at 98 for "a"
+            newId += (char)(g.random().index(26) + 97); //ASCII codes of letters starts at 98 for "a"
         }
 
-        Node& neighbour = g.getRandomNode();
+        NodeHandle neighbour = g.getRandomNode().handle;
 
-        Node& n = g.addNode(newId, newId, &neighbour);
-        vec4f col((float)rand()/RAND_MAX, (float)rand()/RAND_MAX, (float)rand()/RAND_MAX, 0.7);
-        n.setColour(col);
+        NodeHandle n = g.addNode(newId, newId, neighbour);
+        vec4f col;
+        col.x = g.random().uniform(0.0, 1.0);
+        col.y = g.random().uniform(0.0, 1.0);
+        col.z = g.random().uniform(0.0, 1.0);
+        col.w = 0.7;
+        g.getNode(n).setColour(col);
 
         g.addEdge(n, neighbour, SUBCLASS, "voisin");
 
         for(int k=0; k<(nb_rel - 1); ++k) {
 
             //We may pick ourselves, but it's not that a problem
-            Node& n2 = g.getRandomNode();
+            NodeHandle n2 = g.getRandomNode().handle;
             g.addEdge(n, n2, SUBCLASS, "test");
         }
     }
@@ -33,8 +33,11 @@
 #include "constants.h"
 
 #include "graph.h"
+#include "physics_thread.h"
+#include "memory_usage.h"
 
 #include "oro_connector.h"
+#include "ingestion_pipeline.h"
 
 class Node;
 
@@ -46,6 +49,22 @@ class OroView : public SDLApp {
     //Graph
     Graph g;
 
+    //Runs the physics of the graph, at its own pace
+    PhysicsThread physics;
+
+    // Time (in sec) the decay of the nodes is late, because the graph was
+    // busy with a physics step.
+    float pending_decay;
+
+    // Time (in sec) since something last moved on screen (nodes, camera) or
+    // the user interacted. After REDRAW_DELAY, the scene is not redrawn.
+    float quiet_time;
+
+    // Time (in sec) since the scene was last drawn. The scene is redrawn at
+    // least every MAX_REDRAW_INTERVAL.
+    float since_redraw;
+    bool input_received;
+
     //Time
     time_t currtime;
 
@@ -67,11 +86,14 @@ class OroView : public SDLApp {
 
     void updateTime();
 
+    // Reads the current time, and returns true if the displayed date changed.
+    bool updateClock();
+
     //Nodes & users
 
-    Node* hoverNode;
-    void selectNode(Node* node);
-    void addSelectedNode(Node* node);
+    NodeHandle hoverNode;
+    void selectNode(NodeHandle node);
+    void addSelectedNode(NodeHandle node);
     Bounds2D nodesBounds;
     bool display_node_infos;
 
@@ -125,6 +147,15 @@ class OroView : public SDLApp {
      */
     bool advanced_debug;
 
+    /**
+     * Memory used by each subsystem, shown with the debug infos and saved to
+     * memory.json by pushing on M. Refreshed every second in debug mode:
+     * walking the edges takes a while on large graphs.
+     */
+    MemoryUsage memory_usage;
+    float memory_refresh;
+    void updateMemoryUsage();
+
     bool paused;
 
     //Resources
@@ -134,6 +165,11 @@ class OroView : public SDLApp {
     //Connection to the ontology
     OntologyConnector oro;
 
+    // Fetches the resources to add in the background. The main loop adds
+    // them to the graph for at most ingestion_budget ms per frame.
+    IngestionPipeline ingestion;
+    float ingestion_budget;
+
     //Drawing routines
     void drawBloom(Frustum &frustum, float dt);
     void drawBackground(float dt);
@@ -157,7 +193,6 @@ class OroView : public SDLApp {
 
 
     void stylesSetup(const Json::Value& config);
-    void physicsSetup(const Json::Value& config);
     vec4f convertRGBA2Float(const Json::Value& color);
 
     // If false, do not display shadows
@@ -204,18 +239,6 @@ public:
     static void drawVector(vec2f vec, vec2f pos, vec4f col);
 
 
-    /** Add node.
-
-      @return true if the node has been added, false else (can be false for nodes
-      without label is only_labelled_node is true)
-      */
-    bool addNodeConnectedTo(const std::string& id,
-                            const std::string& node_label,
-                            const std::string& to,
-                            relation_type type,
-                            const std::string& edge_label);
-
-    void addAlias(const std::string& alias, const std::string& id);
     Node& getNode(const std::string& id);
 };
 
@@ -0,0 +1,242 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+  oroview-layout -- computes offline the layout of a (large) graph, and
+  saves it in a layout file that oro-view uses to start with an already laid
+  out graph (cf the "layout_cache" configuration key).
+
+  The physics runs headless: neither SDL nor OpenGL are initialized.
+
+  With --snapshot, the whole laid out graph is saved as well, and oro-view
+  loads it without connecting to the ontology (cf --load-snapshot).
+
+  With --benchmark, it times the physics step on the loaded graph instead.
+**/
+
+#include <boost/program_options.hpp>
+
+#include <ctime>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <json/json.h>
+
+#include "macros.h"
+#include "constants.h"
+#include "oroview_exceptions.h"
+
+#include "graph.h"
+#include "layout_cache.h"
+#include "oro_connector.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+/** Loads a graph from a text file, with one edge per line: the IDs of the
+  two nodes, optionally followed by the label of the edge. Lines starting
+  with '#' are ignored.
+**/
+static int loadEdgeList(const string& path, Graph& g) {
+
+    ifstream file(path.c_str());
+    if (!file)
+        throw OroViewException("Can not read the graph from " + path);
+
+    int count = 0;
+    string line;
+
+    Graph::Batch batch(g);
+
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        istringstream fields(line);
+        string from, to, label;
+
+        if (!(fields >> from >> to)) continue;
+        getline(fields >> ws, label);
+
+        NodeHandle n1 = g.addNode(from, from);
+        NodeHandle n2 = g.addNode(to, to, n1);
+        g.addEdge(n1, n2, OBJ_PROPERTY, label);
+
+        count++;
+    }
+
+    return count;
+}
+
+/** Times 'steps' physics steps with each repulsion engine (or with the stress
+  solver, if selected), every node being awake. The graph never comes to
+  rest. Each engine starts from the same layout, so that the timings are
+  comparable.
+**/
+static void benchmark(Graph& g, int steps) {
+
+    REST_DELAY = 0.0;
+    SLEEP_DELAY = 0.0;
+
+    float dt = 1.0 / PHYSICS_TICK_RATE;
+
+    static const char* ENGINE_NAMES[] = {"exact", "barnes-hut", "grid"};
+
+    int engines = LAYOUT_SOLVER == STRESS_SOLVER ? 1 : 3;
+
+    LayoutCache layout;
+    g.storeLayout(layout);
+
+    for (int engine = 0; engine < engines; ++engine) {
+        REPULSION_ENGINE = (repulsion_engine) engine;
+
+        g.applyLayout(layout);
+        for (int i = 0; i < g.nodesCount(); ++i) g.wake(g.getNode(g.getNodes()[i].handle));
+
+        // The first step builds the buffers (and, for the stress solver, its terms)
+        g.step(dt);
+
+        auto start = chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) g.step(dt);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+        cout << (LAYOUT_SOLVER == STRESS_SOLVER ? "stress" : ENGINE_NAMES[engine]) << ": "
+             << elapsed.count() / steps << " ms/step ("
+             << g.threadsCount() << " threads, " << g.kernelsName() << " kernels)" << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    Json::Value config;
+
+    po::positional_options_description p;
+    p.add("configuration", 1);
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("help,h", "produce help message")
+            ("configuration", po::value<string>(), "configuration (JSON, optional): ontology server, physics parameters")
+            ("edges,e", po::value<string>(), "load the graph from this edge list (one 'from to [label]' edge per line) instead of the ontology")
+            ("depth,d", po::value<int>()->default_value(2), "depth of the exploration of the ontology, from the initial concept")
+            ("iterations,n", po::value<int>()->default_value(10000), "maximum amount of physics steps (the layout stops earlier once at rest)")
+            ("output,o", po::value<string>(), "layout file to write (default: the 'layout_cache' of the configuration, or layout.bin)")
+            ("snapshot,s", po::value<string>(), "also write the laid out graph to this snapshot, for oro-view --load-snapshot")
+            ("seed", po::value<unsigned int>(), "seed of the random generator, for reproducible layouts (overrides the configuration)")
+            ("benchmark,b", po::value<int>(), "instead of computing the layout, time this amount of physics steps with each repulsion engine")
+            ;
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv)
+                        .options(desc)
+                        .positional(p)
+                        .run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        cout << "oroview-layout -- Precomputes the layout of a graph for oro-view\n\n" << desc << "\n";
+        return 1;
+    }
+
+    if (vm.count("configuration")) {
+        auto conf = vm["configuration"].as<string>();
+        cout << "Using configuration file " << conf << endl;
+        Json::Reader reader;
+        ifstream conf_file(conf, ifstream::binary);
+        bool parsingOk = reader.parse(conf_file, config);
+        if (!parsingOk) {
+            cerr << "Error while parsing the configuration file!\n"
+                 << reader.getFormattedErrorMessages();
+            exit(1);
+        }
+    }
+
+    if (vm.count("seed")) {
+        config["physics"]["seed"] = vm["seed"].as<unsigned int>();
+    }
+
+    physicsSetup(config);
+
+    string output = config.get("layout_cache", "").asString();
+    if (vm.count("output")) output = vm["output"].as<string>();
+    if (output.empty()) output = "layout.bin";
+
+    try {
+        Graph g;
+
+        g.seed(RANDOM_SEED != 0 ? RANDOM_SEED : time(NULL));
+        cout << "Random seed: " << g.random().getSeed() << endl;
+
+        if (vm.count("edges")) {
+            loadEdgeList(vm["edges"].as<string>(), g);
+        }
+        else {
+            OntologyConnector oro(config.get("oro_host", "localhost").asString(),
+                                  config.get("oro_port", "6969").asString(),
+                                  config.get("only_labelled_nodes", "false").asBool());
+
+            string root = config.get("initial_concept", ROOT_CONCEPT).asString();
+
+            oro.addNode(root, g);
+            oro.walkThroughOntology(root, vm["depth"].as<int>(), g);
+        }
+
+        cout << "Graph loaded: " << g.nodesCount() << " nodes, " << g.edgesCount() << " edges." << endl;
+
+        if (MULTILEVEL_LAYOUT) g.computeInitialLayout();
+
+        if (vm.count("benchmark")) {
+            benchmark(g, vm["benchmark"].as<int>());
+            return 0;
+        }
+
+        int iterations = vm["iterations"].as<int>();
+        float dt = 1.0 / PHYSICS_TICK_RATE;
+
+        int step = 0;
+        for (; step < iterations && !g.isAtRest(); ++step) {
+            g.step(dt);
+
+            if (step % 100 == 0) {
+                if (LAYOUT_SOLVER == STRESS_SOLVER)
+                    cout << "Step " << step << ": stress " << g.stress()
+                         << ", largest move " << g.maxDisplacement() << " px" << endl;
+                else
+                    cout << "Step " << step << ": energy " << g.totalEnergy()
+                         << ", " << g.activeNodesCount() << " nodes awake" << endl;
+            }
+        }
+
+        if (g.isAtRest()) cout << "Layout at rest after " << step << " steps." << endl;
+        else cout << "Layout not at rest after " << step << " steps (energy: " << g.totalEnergy() << ")." << endl;
+
+        LayoutCache cache;
+        g.storeLayout(cache);
+        cache.save(output);
+
+        cout << "Layout of " << cache.size() << " nodes saved to " << output << endl;
+
+        if (vm.count("snapshot")) g.saveSnapshot(vm["snapshot"].as<string>());
+
+    } catch(OroViewException& exception) {
+        cerr << exception.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+  oroview-test -- headless tests of the graph (run by ctest).
+
+  Random sequences of modifications (insertions, removals, aliases,
+  selection changes, physics steps, evictions) are applied to graphs, and
+  Graph::checkConsistency() is called after each of them: it checks the
+  indices of the graph against each other, and the incrementally patched
+  distances to the selection against a full recomputation.
+
+  The stress solver is checked to bring a disconnected graph to rest.
+
+  Returns the amount of failed tests.
+**/
+
+#include <cstdio>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include "constants.h"
+#include "oroview_exceptions.h"
+
+#include "graph.h"
+#include "edge.h"
+#include "random_generator.h"
+
+using namespace std;
+
+/** Returns a new, unique node ID.
+**/
+static string newId(const string& prefix) {
+    static int count = 0;
+
+    ostringstream id;
+    id << prefix << count++;
+    return id.str();
+}
+
+/** Adds a node connected to a random existing node (if any).
+**/
+static NodeHandle addConnectedNode(Graph& g, RandomGenerator& rng) {
+
+    NodeHandle neighbour;
+    if (g.nodesCount() > 0) neighbour = g.getRandomNode().handle;
+
+    string id = newId("n");
+    NodeHandle node = g.addNode(id, id, neighbour);
+
+    if (!neighbour.isNull() && rng.index(4) > 0) g.addEdge(node, neighbour, SUBCLASS, "subclass");
+
+    return node;
+}
+
+/** Removes a random edge of a random node, if it has any.
+**/
+static void removeRandomEdge(Graph& g, RandomGenerator& rng) {
+
+    Node& node = g.getRandomNode();
+    vector<const Edge*> edges = g.getEdgesFor(node);
+
+    if (edges.empty()) return;
+
+    const Edge* edge = edges[rng.index(edges.size())];
+    g.removeEdge(edge->getNode1(), edge->getNode2());
+}
+
+/** Selection changes and insertions only: checks that distances to the
+  selection, patched after each operation, match a full recomputation.
+**/
+static void testDistances(unsigned int seed) {
+
+    Graph g;
+    g.seed(seed);
+
+    RandomGenerator rng;
+    rng.seed(seed);
+
+    for (int i = 0; i < 300; ++i) addConnectedNode(g, rng);
+
+    for (int op = 0; op < 3000; ++op) {
+        switch (rng.index(6)) {
+        case 0:
+            g.deselect(g.getRandomNode().handle);
+            break;
+        case 1:
+            addConnectedNode(g, rng);
+            break;
+        case 2:
+            g.addEdge(g.getRandomNode().handle, g.getRandomNode().handle, SUBCLASS, "subclass");
+            break;
+        case 3:
+            if (rng.index(20) == 0) g.clearSelect();
+            break;
+        default:
+            g.select(g.getRandomNode().handle);
+        }
+
+        g.checkConsistency();
+    }
+}
+
+/** A long chain, selected at one end: distances stop at the cap, and
+  nothing recurses along the chain.
+**/
+static void testChain() {
+
+    Graph g;
+
+    NodeHandle first = g.addNode("chain", "chain");
+    NodeHandle last = first;
+
+    {
+        Graph::Batch batch(g);
+
+        for (int i = 0; i < 100000; ++i) {
+            string id = newId("c");
+            NodeHandle node = g.addNode(id, id, last);
+            g.addEdge(last, node, SUBCLASS, "next");
+            last = node;
+        }
+    }
+
+    g.select(first);
+    g.checkConsistency();
+
+    g.select(last);
+    g.checkConsistency();
+
+    g.deselect(first);
+    g.checkConsistency();
+}
+
+/** Any modification, removals and evictions included: checks the indices
+  of the graph after each one.
+**/
+static void testModifications(unsigned int seed) {
+
+    Graph g;
+    g.seed(seed);
+
+    RandomGenerator rng;
+    rng.seed(seed);
+
+    for (int op = 0; op < 4000; ++op) {
+        if (g.nodesCount() < 3) {
+            addConnectedNode(g, rng);
+            continue;
+        }
+
+        switch (rng.index(10)) {
+        case 0:
+        case 1:
+        case 2:
+            addConnectedNode(g, rng);
+            break;
+        case 3:
+            g.addEdge(g.getRandomNode().handle, g.getRandomNode().handle, SUBCLASS, "subclass");
+            break;
+        case 4:
+            g.removeNode(g.getRandomNode().handle);
+            break;
+        case 5:
+            removeRandomEdge(g, rng);
+            break;
+        case 6:
+            g.select(g.getRandomNode().handle);
+            break;
+        case 7:
+            g.deselect(g.getRandomNode().handle);
+            break;
+        case 8:
+            g.addAlias(newId("alias"), g.getRandomNode().getID());
+            break;
+        default:
+            g.step(1.0 / PHYSICS_TICK_RATE);
+            g.publishPositions();
+            g.interpolate(0.5);
+        }
+
+        if (op % 500 == 0) {
+            NODE_BUDGET = 50;
+            g.enforceNodeBudget();
+            NODE_BUDGET = DEFAULT_NODE_BUDGET;
+        }
+
+        g.checkConsistency();
+    }
+}
+
+/** A snapshot is loaded in place (cf Graph::loadSnapshot): checks the
+  loaded graph, then modifications of it.
+**/
+static void testSnapshot(unsigned int seed) {
+
+    string path = "oroview-test.snapshot";
+
+    {
+        Graph g;
+        g.seed(seed);
+
+        RandomGenerator rng;
+        rng.seed(seed);
+
+        for (int i = 0; i < 2000; ++i) addConnectedNode(g, rng);
+        for (int i = 0; i < 100; ++i) g.addAlias(newId("alias"), g.getRandomNode().getID());
+
+        g.saveSnapshot(path);
+    }
+
+    Graph g;
+    g.seed(seed);
+
+    RandomGenerator rng;
+    rng.seed(seed);
+
+    if (!g.loadSnapshot(path))
+        throw OroViewException("Can not load the snapshot " + path);
+
+    g.checkConsistency();
+
+    for (int op = 0; op < 500; ++op) {
+        switch (rng.index(5)) {
+        case 0:
+            addConnectedNode(g, rng);
+            break;
+        case 1:
+            g.addAlias(newId("alias"), g.getRandomNode().getID());
+            break;
+        case 2:
+            g.select(g.getRandomNode().handle);
+            break;
+        case 3:
+            if (rng.index(10) == 0) g.removeNode(g.getRandomNode().handle);
+            break;
+        default:
+            if (rng.index(10) == 0) removeRandomEdge(g, rng);
+        }
+
+        g.checkConsistency();
+    }
+
+    remove(path.c_str());
+}
+
+/** Disconnected components, laid out by the stress solver: once converged,
+  the graph comes to rest, although the stress jitters with the rounding.
+**/
+static void testStressRest() {
+
+    Graph g;
+    g.seed(1);
+
+    for (int component = 0; component < 50; ++component) {
+        string root = newId("s");
+        NodeHandle previous = g.addNode(root, root);
+
+        for (int i = 1; i < 20; ++i) {
+            string id = newId("s");
+            NodeHandle node = g.addNode(id, id, previous);
+            g.addEdge(previous, node, SUBCLASS, "subclass");
+            previous = node;
+        }
+    }
+
+    layout_solver solver = LAYOUT_SOLVER;
+    float rest_delay = REST_DELAY;
+
+    LAYOUT_SOLVER = STRESS_SOLVER;
+    REST_DELAY = DEFAULT_REST_DELAY;
+
+    float dt = 1.0 / PHYSICS_TICK_RATE;
+    for (int step = 0; step < 3000 && !g.isAtRest(); ++step) g.step(dt);
+
+    LAYOUT_SOLVER = solver;
+    REST_DELAY = rest_delay;
+
+    if (!g.isAtRest())
+        throw OroViewException("The stress layout of a disconnected graph never comes to rest");
+}
+
+/** Runs one test, and reports its result.
+**/
+template<typename Test>
+static bool run(const string& name, Test test) {
+
+    try {
+        test();
+    } catch(OroViewException& exception) {
+        cerr << name << ": FAILED: " << exception.what() << endl;
+        return false;
+    }
+
+    cout << name << ": ok" << endl;
+    return true;
+}
+
+int main() {
+
+    // The graph never comes to rest, so that every step simulates something
+    REST_DELAY = 0.0;
+
+    int failures = 0;
+
+    for (unsigned int seed = 1; seed <= 3; ++seed) {
+        failures += !run("distances", [seed]() {testDistances(seed);});
+        failures += !run("modifications", [seed]() {testModifications(seed);});
+    }
+
+    failures += !run("chain", testChain);
+    failures += !run("snapshot", []() {testSnapshot(1);});
+    failures += !run("stress rest", testStressRest);
+
+    return failures;
+}
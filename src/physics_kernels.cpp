@@ -0,0 +1,282 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include "macros.h"
+
+#include "physics_kernels.h"
+
+// SIMD kernels are compiled for x86 only, each function being compiled for
+// its own instruction set (no need for global -msse/-mavx flags).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WITH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// Distances (squared) below this value are clamped, to avoid infinite forces.
+static const float MIN_LENGTH2 = 0.01;
+
+/*
+  All the kernels compute the Coulomb repulsion the same way. For two nodes
+  i and j, with d = pos_j - pos_i:
+
+      F_i = - K.q_i.q_j / max(|d|^2, 0.01) * d / |d|
+
+  Nodes at the very same position as node i (including i itself) are
+  skipped: their direction is undefined.
+*/
+
+/******************************** Scalar *************************************/
+
+static void repulsionScalar(PhysicsStore& s, int begin, int end, float coulomb_constant) {
+
+    const float* x = &s.x[0];
+    const float* y = &s.y[0];
+    const float* q = &s.charge[0];
+    const int n = s.paddedSize();
+
+    for (int i = begin; i < end; ++i) {
+        float xi = x[i], yi = y[i];
+        float qi = coulomb_constant * q[i];
+
+        float fx = 0.0, fy = 0.0;
+
+        for (int j = 0; j < n; ++j) {
+            float dx = x[j] - xi;
+            float dy = y[j] - yi;
+            float d2 = dx * dx + dy * dy;
+
+            if (d2 == 0.0) continue;
+
+            float w = qi * q[j] / (MAX(d2, MIN_LENGTH2) * sqrt(d2));
+
+            fx -= w * dx;
+            fy -= w * dy;
+        }
+
+        s.fx[i] = fx;
+        s.fy[i] = fy;
+    }
+}
+
+static void integrateScalar(PhysicsStore& s, int begin, int end, float dt, float max_speed, float min_energy) {
+
+    for (int i = begin; i < end; ++i) {
+        float vx = (s.vx[i] + s.fx[i] * dt) * s.damping[i];
+        float vy = (s.vy[i] + s.fy[i] * dt) * s.damping[i];
+
+        vx = CLAMP(vx, -max_speed, max_speed);
+        vy = CLAMP(vy, -max_speed, max_speed);
+
+        float energy = s.mass[i] * (vx * vx + vy * vy);
+
+        s.vx[i] = vx;
+        s.vy[i] = vy;
+        s.kinetic_energy[i] = energy;
+
+        //Check we have enough energy to move :)
+        if (energy > min_energy) {
+            s.next_x[i] = s.x[i] + vx * dt;
+            s.next_y[i] = s.y[i] + vy * dt;
+        }
+        else {
+            s.next_x[i] = s.x[i];
+            s.next_y[i] = s.y[i];
+        }
+    }
+}
+
+static const PhysicsKernels SCALAR_KERNELS = {"scalar", &repulsionScalar, &integrateScalar};
+
+#ifdef WITH_X86_KERNELS
+
+/********************************** SSE **************************************/
+
+__attribute__((target("sse2")))
+static void repulsionSSE(PhysicsStore& s, int begin, int end, float coulomb_constant) {
+
+    const float* x = &s.x[0];
+    const float* y = &s.y[0];
+    const float* q = &s.charge[0];
+    const int n = s.paddedSize();
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 min_len2 = _mm_set1_ps(MIN_LENGTH2);
+
+    for (int i = begin; i < end; ++i) {
+        const __m128 xi = _mm_set1_ps(x[i]);
+        const __m128 yi = _mm_set1_ps(y[i]);
+        const __m128 qi = _mm_set1_ps(coulomb_constant * q[i]);
+
+        __m128 fx = zero, fy = zero;
+
+        for (int j = 0; j < n; j += 4) {
+            __m128 dx = _mm_sub_ps(_mm_load_ps(x + j), xi);
+            __m128 dy = _mm_sub_ps(_mm_load_ps(y + j), yi);
+            __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            __m128 w = _mm_div_ps(_mm_mul_ps(qi, _mm_load_ps(q + j)),
+                                  _mm_mul_ps(_mm_max_ps(d2, min_len2), _mm_sqrt_ps(d2)));
+            // null distances lead to inf or nan: discard them
+            w = _mm_and_ps(w, _mm_cmpgt_ps(d2, zero));
+
+            fx = _mm_sub_ps(fx, _mm_mul_ps(w, dx));
+            fy = _mm_sub_ps(fy, _mm_mul_ps(w, dy));
+        }
+
+        float __attribute__((aligned(16))) rx[4], ry[4];
+        _mm_store_ps(rx, fx);
+        _mm_store_ps(ry, fy);
+
+        s.fx[i] = (rx[0] + rx[1]) + (rx[2] + rx[3]);
+        s.fy[i] = (ry[0] + ry[1]) + (ry[2] + ry[3]);
+    }
+}
+
+__attribute__((target("sse2")))
+static void integrateSSE(PhysicsStore& s, int begin, int end, float dt, float max_speed, float min_energy) {
+
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vmax = _mm_set1_ps(max_speed);
+    const __m128 vmin = _mm_set1_ps(-max_speed);
+    const __m128 emin = _mm_set1_ps(min_energy);
+
+    int i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 damping = _mm_loadu_ps(&s.damping[i]);
+
+        __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&s.vx[i]), _mm_mul_ps(_mm_loadu_ps(&s.fx[i]), vdt)), damping);
+        __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&s.vy[i]), _mm_mul_ps(_mm_loadu_ps(&s.fy[i]), vdt)), damping);
+
+        vx = _mm_min_ps(_mm_max_ps(vx, vmin), vmax);
+        vy = _mm_min_ps(_mm_max_ps(vy, vmin), vmax);
+
+        __m128 energy = _mm_mul_ps(_mm_loadu_ps(&s.mass[i]),
+                                   _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+
+        __m128 moving = _mm_cmpgt_ps(energy, emin);
+
+        _mm_storeu_ps(&s.vx[i], vx);
+        _mm_storeu_ps(&s.vy[i], vy);
+        _mm_storeu_ps(&s.kinetic_energy[i], energy);
+
+        _mm_storeu_ps(&s.next_x[i], _mm_add_ps(_mm_loadu_ps(&s.x[i]), _mm_and_ps(moving, _mm_mul_ps(vx, vdt))));
+        _mm_storeu_ps(&s.next_y[i], _mm_add_ps(_mm_loadu_ps(&s.y[i]), _mm_and_ps(moving, _mm_mul_ps(vy, vdt))));
+    }
+
+    integrateScalar(s, i, end, dt, max_speed, min_energy);
+}
+
+static const PhysicsKernels SSE_KERNELS = {"SSE", &repulsionSSE, &integrateSSE};
+
+/********************************** AVX **************************************/
+
+__attribute__((target("avx")))
+static void repulsionAVX(PhysicsStore& s, int begin, int end, float coulomb_constant) {
+
+    const float* x = &s.x[0];
+    const float* y = &s.y[0];
+    const float* q = &s.charge[0];
+    const int n = s.paddedSize();
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 min_len2 = _mm256_set1_ps(MIN_LENGTH2);
+
+    for (int i = begin; i < end; ++i) {
+        const __m256 xi = _mm256_set1_ps(x[i]);
+        const __m256 yi = _mm256_set1_ps(y[i]);
+        const __m256 qi = _mm256_set1_ps(coulomb_constant * q[i]);
+
+        __m256 fx = zero, fy = zero;
+
+        for (int j = 0; j < n; j += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_load_ps(x + j), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_load_ps(y + j), yi);
+            __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+            __m256 w = _mm256_div_ps(_mm256_mul_ps(qi, _mm256_load_ps(q + j)),
+                                     _mm256_mul_ps(_mm256_max_ps(d2, min_len2), _mm256_sqrt_ps(d2)));
+            // null distances lead to inf or nan: discard them
+            w = _mm256_and_ps(w, _mm256_cmp_ps(d2, zero, _CMP_GT_OQ));
+
+            fx = _mm256_sub_ps(fx, _mm256_mul_ps(w, dx));
+            fy = _mm256_sub_ps(fy, _mm256_mul_ps(w, dy));
+        }
+
+        float __attribute__((aligned(32))) rx[8], ry[8];
+        _mm256_store_ps(rx, fx);
+        _mm256_store_ps(ry, fy);
+
+        s.fx[i] = ((rx[0] + rx[1]) + (rx[2] + rx[3])) + ((rx[4] + rx[5]) + (rx[6] + rx[7]));
+        s.fy[i] = ((ry[0] + ry[1]) + (ry[2] + ry[3])) + ((ry[4] + ry[5]) + (ry[6] + ry[7]));
+    }
+}
+
+__attribute__((target("avx")))
+static void integrateAVX(PhysicsStore& s, int begin, int end, float dt, float max_speed, float min_energy) {
+
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vmax = _mm256_set1_ps(max_speed);
+    const __m256 vmin = _mm256_set1_ps(-max_speed);
+    const __m256 emin = _mm256_set1_ps(min_energy);
+
+    int i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 damping = _mm256_loadu_ps(&s.damping[i]);
+
+        __m256 vx = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&s.vx[i]), _mm256_mul_ps(_mm256_loadu_ps(&s.fx[i]), vdt)), damping);
+        __m256 vy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&s.vy[i]), _mm256_mul_ps(_mm256_loadu_ps(&s.fy[i]), vdt)), damping);
+
+        vx = _mm256_min_ps(_mm256_max_ps(vx, vmin), vmax);
+        vy = _mm256_min_ps(_mm256_max_ps(vy, vmin), vmax);
+
+        __m256 energy = _mm256_mul_ps(_mm256_loadu_ps(&s.mass[i]),
+                                      _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)));
+
+        __m256 moving = _mm256_cmp_ps(energy, emin, _CMP_GT_OQ);
+
+        _mm256_storeu_ps(&s.vx[i], vx);
+        _mm256_storeu_ps(&s.vy[i], vy);
+        _mm256_storeu_ps(&s.kinetic_energy[i], energy);
+
+        _mm256_storeu_ps(&s.next_x[i], _mm256_add_ps(_mm256_loadu_ps(&s.x[i]), _mm256_and_ps(moving, _mm256_mul_ps(vx, vdt))));
+        _mm256_storeu_ps(&s.next_y[i], _mm256_add_ps(_mm256_loadu_ps(&s.y[i]), _mm256_and_ps(moving, _mm256_mul_ps(vy, vdt))));
+    }
+
+    integrateSSE(s, i, end, dt, max_speed, min_energy);
+}
+
+static const PhysicsKernels AVX_KERNELS = {"AVX", &repulsionAVX, &integrateAVX};
+
+#endif // WITH_X86_KERNELS
+
+const PhysicsKernels& selectPhysicsKernels(bool allow_simd) {
+
+#ifdef WITH_X86_KERNELS
+    if (allow_simd) {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx")) return AVX_KERNELS;
+        if (__builtin_cpu_supports("sse2")) return SSE_KERNELS;
+    }
+#endif
+
+    return SCALAR_KERNELS;
+}
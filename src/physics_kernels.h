@@ -0,0 +1,56 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHYSICS_KERNELS_H
+#define PHYSICS_KERNELS_H
+
+#include "physics_store.h"
+
+/**
+  Force and integration kernels working on a PhysicsStore.
+
+  Several implementations exist (scalar, SSE, AVX). The best one supported
+  by the CPU is selected at runtime by selectPhysicsKernels().
+
+  Kernels only process the nodes in [begin, end): they can run concurrently
+  on disjoint ranges.
+  */
+struct PhysicsKernels {
+
+    const char* name;
+
+    /**
+      Exact Coulomb repulsion: for each node in [begin, end), sets (fx, fy)
+      to the sum of the repulsions of all the other nodes of the store.
+      */
+    void (*repulsion)(PhysicsStore& store, int begin, int end, float coulomb_constant);
+
+    /**
+      Integrates (fx, fy) over dt: updates the speeds and kinetic energies,
+      and writes the new positions in (next_x, next_y). Nodes whose kinetic
+      energy is below min_energy do not move.
+      */
+    void (*integrate)(PhysicsStore& store, int begin, int end, float dt, float max_speed, float min_energy);
+};
+
+/**
+  Returns the fastest kernels supported by the CPU. If allow_simd is false,
+  always returns the scalar kernels.
+  */
+const PhysicsKernels& selectPhysicsKernels(bool allow_simd = true);
+
+#endif // PHYSICS_KERNELS_H
@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "memory_usage.h"
+
+#include "physics_store.h"
+
+PhysicsStore::PhysicsStore() :
+    count(0)
+{
+}
+
+void PhysicsStore::resize(int count) {
+
+    this->count = count;
+
+    int padded = ((count + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+
+    if (padded != (int) x.size()) {
+        x.resize(padded); y.resize(padded);
+        next_x.resize(padded); next_y.resize(padded);
+        vx.resize(padded); vy.resize(padded);
+        fx.resize(padded); fy.resize(padded);
+        charge.resize(padded);
+        mass.resize(padded);
+        damping.resize(padded);
+        kinetic_energy.resize(padded);
+    }
+
+    // padding elements must not repulse anything
+    for (int i = count; i < padded; ++i) charge[i] = 0.0;
+}
+
+int PhysicsStore::size() const {
+    return count;
+}
+
+int PhysicsStore::paddedSize() const {
+    return x.size();
+}
+
+size_t PhysicsStore::memoryUsage() const {
+    return capacityBytes(x) + capacityBytes(y) +
+           capacityBytes(next_x) + capacityBytes(next_y) +
+           capacityBytes(vx) + capacityBytes(vy) +
+           capacityBytes(fx) + capacityBytes(fy) +
+           capacityBytes(charge) + capacityBytes(mass) +
+           capacityBytes(damping) + capacityBytes(kinetic_energy);
+}
@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHYSICS_STORE_H
+#define PHYSICS_STORE_H
+
+#include <vector>
+
+#include <boost/align/aligned_allocator.hpp>
+
+// Arrays are aligned and padded for the widest SIMD registers we use (AVX).
+static const int SIMD_ALIGNMENT = 32;
+static const int SIMD_WIDTH = 8;
+
+typedef std::vector<float, boost::alignment::aligned_allocator<float, SIMD_ALIGNMENT> > FloatArray;
+
+/**
+  Physical state of the nodes, packed as a structure of arrays.
+
+  The i-th element of each array belongs to the i-th node of the graph (in
+  insertion order, cf Node::index). The store is filled from the nodes at the
+  beginning of each step, and the results are copied back at the end
+  (cf Graph::step).
+
+  Arrays are padded up to a multiple of SIMD_WIDTH. Padding elements have a
+  null charge, so that they do not contribute to the repulsion.
+  */
+class PhysicsStore
+{
+    int count;
+
+public:
+    PhysicsStore();
+
+    // Positions at the beginning of the step (front buffer)
+    FloatArray x, y;
+    // Positions at the end of the step (back buffer)
+    FloatArray next_x, next_y;
+
+    FloatArray vx, vy;
+    // Sum of the forces applied on each node during the step
+    FloatArray fx, fy;
+
+    FloatArray charge;
+    FloatArray mass;
+    FloatArray damping;
+    FloatArray kinetic_energy;
+
+    void resize(int count);
+
+    int size() const;
+    int paddedSize() const;
+
+    size_t memoryUsage() const;
+};
+
+#endif // PHYSICS_STORE_H
@@ -0,0 +1,123 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <thread>
+
+#include <boost/thread/locks.hpp>
+
+#include "macros.h"
+
+#include "graph.h"
+#include "physics_thread.h"
+
+using namespace std;
+
+PhysicsThread::PhysicsThread(Graph& graph) :
+    graph(graph),
+    thread(NULL),
+    running(false),
+    paused(false),
+    tick(1.0 / 60.0),
+    last_tick(0),
+    step_time(0.0)
+{
+}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::start(float tick_rate) {
+
+    stop();
+
+    tick = 1.0 / tick_rate;
+    last_tick = Clock::now().time_since_epoch().count();
+
+    running = true;
+    thread = new boost::thread(&PhysicsThread::run, this);
+
+    TRACE("Physics thread started at " << tick_rate << " steps per second");
+}
+
+void PhysicsThread::stop() {
+
+    if (thread == NULL) return;
+
+    running = false;
+    thread->join();
+
+    delete thread;
+    thread = NULL;
+}
+
+void PhysicsThread::setPaused(bool paused) {
+    this->paused = paused;
+}
+
+float PhysicsThread::stepTime() const {
+    return step_time;
+}
+
+float PhysicsThread::interpolationFactor() const {
+
+    if (paused) return 1.0;
+
+    Clock::duration elapsed = Clock::now().time_since_epoch() - Clock::duration(last_tick);
+
+    float alpha = chrono::duration<float>(elapsed).count() / tick;
+
+    return CLAMP(alpha, 0.0f, 1.0f);
+}
+
+void PhysicsThread::run() {
+
+    Clock::duration tick_duration = chrono::duration_cast<Clock::duration>(chrono::duration<float>(tick));
+    Clock::time_point next_tick = Clock::now();
+
+    while (running) {
+
+        // Once the graph is at rest, the positions do not change anymore:
+        // nothing to step, nor to publish.
+        if (!paused && !graph.isAtRest()) {
+            Clock::time_point start = Clock::now();
+
+            {
+                boost::lock_guard<boost::mutex> l(graph.getMutex());
+
+                graph.step(tick);
+                graph.publishPositions();
+            }
+
+            Clock::time_point end = Clock::now();
+
+            last_tick = end.time_since_epoch().count();
+            step_time = chrono::duration<float, milli>(end - start).count();
+        }
+
+        next_tick += tick_duration;
+
+        Clock::time_point now = Clock::now();
+        if (next_tick < now) {
+            // Late: do not try to catch up, but let the other threads grab
+            // the graph mutex before the next step.
+            next_tick = now;
+            boost::this_thread::yield();
+        }
+        else this_thread::sleep_until(next_tick);
+    }
+}
@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include <atomic>
+#include <chrono>
+
+#include <boost/thread/thread.hpp>
+
+class Graph;
+
+/**
+  Runs the physics of a graph in a dedicated thread, at a fixed tick rate,
+  independently of the rendering framerate.
+
+  Each tick steps the graph (with the graph mutex held), then publishes the
+  new positions of the nodes. The rendering thread interpolates between the
+  two last published positions (cf interpolationFactor()).
+
+  If a step takes longer than a tick, the simulation simply runs slower than
+  real time: ticks are never accumulated to catch up. While the graph is at
+  rest (cf Graph::isAtRest()), the thread only sleeps.
+  */
+class PhysicsThread
+{
+public:
+    PhysicsThread(Graph& graph);
+    ~PhysicsThread();
+
+    /**
+      Starts the simulation, with 'tick_rate' steps per second.
+      */
+    void start(float tick_rate);
+    void stop();
+
+    void setPaused(bool paused);
+
+    /**
+      Where we are between the two last published steps, between 0 and 1.
+      To be passed to Graph::interpolate().
+      */
+    float interpolationFactor() const;
+
+    /**
+      Duration of the last step, in milliseconds.
+      */
+    float stepTime() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Graph& graph;
+
+    boost::thread* thread;
+
+    std::atomic<bool> running;
+    std::atomic<bool> paused;
+
+    // Duration of a tick, in seconds
+    float tick;
+
+    // Time of the last publication, in Clock ticks since the Clock epoch
+    std::atomic<Clock::rep> last_tick;
+    std::atomic<float> step_time;
+
+    void run();
+};
+
+#endif // PHYSICS_THREAD_H
@@ -0,0 +1,46 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "random_generator.h"
+
+RandomGenerator::RandomGenerator(unsigned int seed) :
+    engine(seed),
+    current_seed(seed)
+{
+}
+
+void RandomGenerator::seed(unsigned int seed) {
+    current_seed = seed;
+    engine.seed(seed);
+}
+
+unsigned int RandomGenerator::getSeed() const {
+    return current_seed;
+}
+
+float RandomGenerator::uniform(float min, float max) {
+    boost::random::uniform_real_distribution<float> distribution(min, max);
+    return distribution(engine);
+}
+
+int RandomGenerator::index(int count) {
+    boost::random::uniform_int_distribution<int> distribution(0, count - 1);
+    return distribution(engine);
+}
@@ -0,0 +1,56 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RANDOM_GENERATOR_H
+#define RANDOM_GENERATOR_H
+
+#include <boost/random/mersenne_twister.hpp>
+
+/**
+  Pseudo-random numbers used to build and lay out the graph (initial
+  positions of the nodes, random nodes...).
+
+  The generator (a Mersenne twister) and the distributions come from
+  Boost.Random, whose output is specified: for a given seed, the same
+  sequence is produced on every platform, and so are the layouts.
+  */
+class RandomGenerator
+{
+    boost::random::mt19937 engine;
+    unsigned int current_seed;
+
+public:
+    RandomGenerator(unsigned int seed = 1);
+
+    /**
+      Restarts the sequence from the given seed.
+      */
+    void seed(unsigned int seed);
+    unsigned int getSeed() const;
+
+    /**
+      Returns a float uniformly distributed in [min, max).
+      */
+    float uniform(float min, float max);
+
+    /**
+      Returns an integer uniformly distributed in [0, count).
+      */
+    int index(int count);
+};
+
+#endif // RANDOM_GENERATOR_H
@@ -0,0 +1,189 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "macros.h"
+#include "memory_usage.h"
+
+#include "relation_table.h"
+
+using namespace std;
+
+RelationTable::RelationTable()
+{
+}
+
+void RelationTable::clear() {
+    from_nodes.clear();
+    to_nodes.clear();
+    types.clear();
+    labels.clear();
+    outgoing_index.clear();
+    incoming_index.clear();
+}
+
+void RelationTable::shrink() {
+    outgoing_index.shrink();
+    incoming_index.shrink();
+}
+
+int RelationTable::size() const {
+    return from_nodes.size();
+}
+
+size_t RelationTable::memoryUsage() const {
+    return capacityBytes(from_nodes) + capacityBytes(to_nodes) +
+           capacityBytes(types) + capacityBytes(labels) +
+           outgoing_index.memoryUsage() + incoming_index.memoryUsage();
+}
+
+void RelationTable::reserve(int count) {
+    from_nodes.reserve(from_nodes.size() + count);
+    to_nodes.reserve(to_nodes.size() + count);
+    types.reserve(types.size() + count);
+    labels.reserve(labels.size() + count);
+}
+
+void RelationTable::addNode(int outgoing, int incoming) {
+    outgoing_index.addNode(outgoing);
+    incoming_index.addNode(incoming);
+}
+
+int RelationTable::add(int from, int to, relation_type type, Symbol label) {
+
+    int relation = append(from, to, type, label);
+
+    if (find(to, from) < 0) {
+        append(to, from, UNDEFINED, Symbol());
+        TRACE("Added UNDEFINED back relation");
+    }
+
+    return relation;
+}
+
+int RelationTable::append(int from, int to, relation_type type, Symbol label) {
+
+    int relation = from_nodes.size();
+
+    appendColumns(from, to, type, label);
+
+    outgoing_index.addArc(from, to, relation);
+    incoming_index.addArc(to, from, relation);
+
+    return relation;
+}
+
+void RelationTable::appendColumns(int from, int to, relation_type type, Symbol label) {
+    from_nodes.push_back(from);
+    to_nodes.push_back(to);
+    types.push_back(type);
+    labels.push_back(label);
+}
+
+void RelationTable::assignOutgoing(const vector<uint32_t>& offsets, vector<AdjacencyIndex::Neighbour>& neighbours) {
+    outgoing_index.assign(offsets, neighbours);
+}
+
+void RelationTable::assignIncoming(const vector<uint32_t>& offsets, vector<AdjacencyIndex::Neighbour>& neighbours) {
+    incoming_index.assign(offsets, neighbours);
+}
+
+int RelationTable::find(int from, int to) const {
+
+    if (outgoing_index.degree(from) <= incoming_index.degree(to)) {
+        for (AdjacencyIndex::const_iterator n = outgoing_index.begin(from); n != outgoing_index.end(from); ++n) {
+            if (n->node == to) return n->edge;
+        }
+    }
+    else {
+        for (AdjacencyIndex::const_iterator n = incoming_index.begin(to); n != incoming_index.end(to); ++n) {
+            if (n->node == from) return n->edge;
+        }
+    }
+
+    return -1;
+}
+
+bool RelationTable::connected(int node1, int node2) const {
+    return find(node1, node2) >= 0 || find(node2, node1) >= 0;
+}
+
+NodeRelation RelationTable::get(int relation) const {
+    return NodeRelation(from_nodes[relation], to_nodes[relation], types[relation], labels[relation]);
+}
+
+void RelationTable::removeBetween(int node1, int node2) {
+
+    int relation;
+
+    while ((relation = find(node1, node2)) >= 0) remove(relation);
+
+    if (node1 == node2) return;
+
+    while ((relation = find(node2, node1)) >= 0) remove(relation);
+}
+
+void RelationTable::remove(int relation) {
+
+    outgoing_index.removeArc(from_nodes[relation], relation);
+    incoming_index.removeArc(to_nodes[relation], relation);
+
+    // The last relation takes the index of the removed one
+    int last = from_nodes.size() - 1;
+
+    if (relation != last) {
+        outgoing_index.renameArc(from_nodes[last], last, relation);
+        incoming_index.renameArc(to_nodes[last], last, relation);
+
+        from_nodes[relation] = from_nodes[last];
+        to_nodes[relation] = to_nodes[last];
+        types[relation] = types[last];
+        labels[relation] = labels[last];
+    }
+
+    from_nodes.pop_back();
+    to_nodes.pop_back();
+    types.pop_back();
+    labels.pop_back();
+}
+
+void RelationTable::removeNode(int node) {
+
+    removeBetween(node, node);
+
+    int last = outgoing_index.nodesCount() - 1;
+
+    // The relations of the moved node, and the rows at their other end,
+    // now refer to it by its new index
+    if (node != last) {
+        for (AdjacencyIndex::const_iterator n = outgoing_index.begin(last); n != outgoing_index.end(last); ++n) {
+            if (n->node != last) incoming_index.renameNeighbour(n->node, last, node);
+            from_nodes[n->edge] = node;
+        }
+        for (AdjacencyIndex::const_iterator n = incoming_index.begin(last); n != incoming_index.end(last); ++n) {
+            if (n->node != last) outgoing_index.renameNeighbour(n->node, last, node);
+            to_nodes[n->edge] = node;
+        }
+
+        // Relations of the moved node to itself
+        outgoing_index.renameNeighbour(last, last, node);
+        incoming_index.renameNeighbour(last, last, node);
+    }
+
+    outgoing_index.removeRow(node);
+    incoming_index.removeRow(node);
+}
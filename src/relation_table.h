@@ -0,0 +1,145 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RELATION_TABLE_H
+#define RELATION_TABLE_H
+
+#include <vector>
+
+#include "constants.h"
+#include "adjacency.h"
+#include "node_relation.h"
+#include "string_pool.h"
+
+/**
+  The relations between the nodes of the graph, stored once, column by
+  column: the origin, the destination, the type and the label of each
+  relation. Relations are identified by their index in the columns.
+
+  The relations of each node are indexed by two AdjacencyIndex, used in a
+  directed way: the outgoing relations of a node are found in its row of
+  outgoing(), the incoming ones in its row of incoming(). In both, the
+  'node' of an entry is the node at the other end, and its 'edge' the
+  relation.
+
+  Nodes are identified by their index (cf Node::index).
+  */
+class RelationTable
+{
+public:
+    RelationTable();
+
+    /**
+      Appends a new node (with no relation yet). Its index is the current
+      amount of nodes. Its rows are created with room for the given amounts
+      of relations (cf AdjacencyIndex::addNode()).
+      */
+    void addNode(int outgoing = 0, int incoming = 0);
+
+    /**
+      Adds a relation from a node to another one, and returns it. If 'to'
+      has no relation yet to 'from', an UNDEFINED reciprocal relation is
+      added as well, so that both nodes are always connected both ways.
+      */
+    int add(int from, int to, relation_type type, Symbol label);
+
+    /**
+      Adds a relation as it is, without any reciprocal relation.
+      */
+    int append(int from, int to, relation_type type, Symbol label);
+
+    /**
+      Adds a relation to the columns only, without indexing it: meant to
+      restore saved relations (cf Graph::loadSnapshot()), whose rows are then
+      given at once to assignOutgoing() and assignIncoming().
+      */
+    void appendColumns(int from, int to, relation_type type, Symbol label);
+
+    /**
+      Replace the rows of outgoing() and incoming() (cf
+      AdjacencyIndex::assign()).
+      */
+    void assignOutgoing(const std::vector<uint32_t>& offsets, std::vector<AdjacencyIndex::Neighbour>& neighbours);
+    void assignIncoming(const std::vector<uint32_t>& offsets, std::vector<AdjacencyIndex::Neighbour>& neighbours);
+
+    /**
+      Returns the first relation from a node to another one, or -1 if there
+      is none. Looks up the smallest of the two rows involved.
+      */
+    int find(int from, int to) const;
+
+    /**
+      Whether there is any relation between two nodes, in either direction.
+      */
+    bool connected(int node1, int node2) const;
+
+    /**
+      Removes all the relations between two nodes, in both directions. The
+      last relations take the indices of the removed ones.
+      */
+    void removeBetween(int node1, int node2);
+
+    /**
+      Removes a node and whatever relation it still has to itself. Its
+      relations to the other nodes must have been removed first. The last
+      node takes its index.
+      */
+    void removeNode(int node);
+
+    NodeRelation get(int relation) const;
+
+    int from(int relation) const {return from_nodes[relation];}
+    int to(int relation) const {return to_nodes[relation];}
+    relation_type type(int relation) const {return types[relation];}
+    Symbol label(int relation) const {return labels[relation];}
+
+    const AdjacencyIndex& outgoing() const {return outgoing_index;}
+    const AdjacencyIndex& incoming() const {return incoming_index;}
+
+    int size() const;
+
+    /**
+      Prepares the columns for 'count' more relations.
+      */
+    void reserve(int count);
+
+    void clear();
+
+    /**
+      Bytes allocated by the columns and the per-node indices.
+      */
+    size_t memoryUsage() const;
+
+    /**
+      Compacts the per-node indices (cf AdjacencyIndex::shrink()).
+      */
+    void shrink();
+
+private:
+    std::vector<int> from_nodes;
+    std::vector<int> to_nodes;
+    std::vector<relation_type> types;
+    std::vector<Symbol> labels;
+
+    AdjacencyIndex outgoing_index;
+    AdjacencyIndex incoming_index;
+
+    void remove(int relation);
+};
+
+#endif // RELATION_TABLE_H
@@ -0,0 +1,237 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "memory_usage.h"
+#include "oroview_exceptions.h"
+
+/**
+  Stable, 32-bit reference to a value of a SlotMap: the index of its slot (24
+  bits) and the generation of the slot (8 bits). The generation changes each
+  time the value of the slot is erased, so that a handle to an erased value is
+  told apart from a handle to the value that later reuses its slot.
+
+  The default handle is null: it never refers to any value.
+  */
+class SlotHandle
+{
+    uint32_t value;
+
+public:
+    static const uint32_t SLOT_BITS = 24;
+    static const uint32_t MAX_SLOTS = (1u << SLOT_BITS) - 1;
+
+    SlotHandle() : value(0xFFFFFFFF) {}
+    SlotHandle(uint32_t slot, uint32_t generation) :
+        value((generation << SLOT_BITS) | (slot & MAX_SLOTS)) {}
+
+    uint32_t slot() const {return value & MAX_SLOTS;}
+    uint32_t generation() const {return value >> SLOT_BITS;}
+
+    bool isNull() const {return value == 0xFFFFFFFF;}
+
+    /** Raw 32-bit value, eg to serialise the handle.
+    **/
+    uint32_t raw() const {return value;}
+
+    bool operator==(const SlotHandle& other) const {return value == other.value;}
+    bool operator!=(const SlotHandle& other) const {return value != other.value;}
+    bool operator<(const SlotHandle& other) const {return value < other.value;}
+};
+
+/**
+  Container that stores its values contiguously, in a dense array, and gives
+  out stable handles to them.
+
+  Values are appended at the end of the dense array: as long as nothing is
+  erased, the dense index of a value is its insertion rank. Erasing a value
+  moves the last one in its place (its handle remains valid). Like for a
+  std::vector, pointers and references to the values are invalidated by
+  insertions and erasures: keep handles instead.
+
+  Lookup, insertion and erasure are O(1).
+  */
+template <class T>
+class SlotMap
+{
+    struct Slot {
+        int dense;          // index of the value in the dense array, -1 if free
+        uint32_t generation;
+    };
+
+    std::vector<T> values;
+    std::vector<uint32_t> dense_slots; // slot of each value of the dense array
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+
+    // Generation of a slot once its value is erased. The handle of the last
+    // slot with the last generation would be the null handle: it is skipped.
+    static uint32_t nextGeneration(uint32_t slot, uint32_t generation) {
+        generation = (generation + 1) & 0xFF;
+        if (SlotHandle(slot, generation).isNull())
+            generation = 0;
+        return generation;
+    }
+
+public:
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    /**
+      Appends a copy of the value, and returns its handle. Throws an
+      OroViewException once every slot is used (SlotHandle::MAX_SLOTS + 1
+      values).
+      */
+    SlotHandle insert(const T& value) {
+        uint32_t slot;
+
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        else {
+            if (slots.size() > SlotHandle::MAX_SLOTS)
+                throw OroViewException("Too many values in the slot map");
+
+            slot = slots.size();
+            Slot s = {-1, 0};
+            slots.push_back(s);
+        }
+
+        slots[slot].dense = values.size();
+        values.push_back(value);
+        dense_slots.push_back(slot);
+
+        return SlotHandle(slot, slots[slot].generation);
+    }
+
+    /**
+      Erases the value, if the handle is still valid. The last value of the
+      dense array takes its dense index.
+      */
+    void erase(SlotHandle handle) {
+        int dense = indexOf(handle);
+        if (dense < 0) return;
+
+        int last = values.size() - 1;
+
+        if (dense != last) {
+            values[dense] = values[last];
+            dense_slots[dense] = dense_slots[last];
+            slots[dense_slots[dense]].dense = dense;
+        }
+
+        values.pop_back();
+        dense_slots.pop_back();
+
+        Slot& s = slots[handle.slot()];
+        s.dense = -1;
+        s.generation = nextGeneration(handle.slot(), s.generation);
+        free_slots.push_back(handle.slot());
+    }
+
+    /**
+      Dense index of the value, or -1 if the handle is null or refers to an
+      erased value.
+      */
+    int indexOf(SlotHandle handle) const {
+        if (handle.isNull() || handle.slot() >= slots.size()) return -1;
+
+        const Slot& s = slots[handle.slot()];
+        if (s.generation != handle.generation()) return -1;
+
+        return s.dense;
+    }
+
+    bool contains(SlotHandle handle) const {
+        return indexOf(handle) >= 0;
+    }
+
+    /**
+      Pointer to the value, or NULL if the handle is not valid.
+      */
+    T* find(SlotHandle handle) {
+        int dense = indexOf(handle);
+        return dense < 0 ? NULL : &values[dense];
+    }
+
+    const T* find(SlotHandle handle) const {
+        int dense = indexOf(handle);
+        return dense < 0 ? NULL : &values[dense];
+    }
+
+    /**
+      Handle of the value at the given dense index.
+      */
+    SlotHandle handleAt(int dense) const {
+        uint32_t slot = dense_slots[dense];
+        return SlotHandle(slot, slots[slot].generation);
+    }
+
+    /**
+      Value at the given dense index.
+      */
+    T& operator[](int dense) {return values[dense];}
+    const T& operator[](int dense) const {return values[dense];}
+
+    int size() const {return values.size();}
+    bool empty() const {return values.empty();}
+
+    void reserve(int count) {
+        values.reserve(count);
+        dense_slots.reserve(count);
+        slots.reserve(count);
+    }
+
+    /**
+      Erases every value. The slots are kept: handles to the erased values
+      remain invalid.
+      */
+    void clear() {
+        for (size_t k = 0; k < dense_slots.size(); ++k) {
+            Slot& s = slots[dense_slots[k]];
+            s.dense = -1;
+            s.generation = nextGeneration(dense_slots[k], s.generation);
+            free_slots.push_back(dense_slots[k]);
+        }
+
+        values.clear();
+        dense_slots.clear();
+    }
+
+    /**
+      Bytes allocated by the map itself. What the values allocate is not
+      included.
+      */
+    size_t memoryUsage() const {
+        return capacityBytes(values) + capacityBytes(dense_slots) +
+               capacityBytes(slots) + capacityBytes(free_slots);
+    }
+
+    iterator begin() {return values.begin();}
+    iterator end() {return values.end();}
+    const_iterator begin() const {return values.begin();}
+    const_iterator end() const {return values.end();}
+};
+
+#endif // SLOT_MAP_H
@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+/**
+  Publishes immutable snapshots of some state to threads that read them
+  without locking (read-copy-update).
+
+  Writers build a complete new snapshot, and publish it in a single atomic
+  store. Readers pin the latest snapshot with a Reader: as long as it lives,
+  the snapshot is not deleted, even if newer ones are published.
+
+  Snapshots that have been replaced are reclaimed by the writers with
+  epochs: each publication increments a global epoch, and each Reader
+  announces the epoch at which it started. A replaced snapshot is deleted
+  once every announced epoch is more recent than its replacement.
+
+  Writers must be serialised by the caller (eg by holding the graph mutex).
+  At most MAX_READERS Readers can be alive at once: further ones wait.
+  */
+template<class T>
+class SnapshotChannel
+{
+public:
+    static const int MAX_READERS = 16;
+
+    class Reader
+    {
+        SnapshotChannel& channel;
+        int reader;
+        const T* snapshot;
+
+        Reader(const Reader&);
+        Reader& operator=(const Reader&);
+
+    public:
+        Reader(SnapshotChannel& channel) : channel(channel) {
+
+            for (reader = 0; ; reader = (reader + 1) % MAX_READERS) {
+                unsigned long free = 0;
+                if (channel.readers[reader].compare_exchange_strong(free, channel.epoch.load()))
+                    break;
+            }
+
+            // Loaded after the epoch is announced: a snapshot replaced after
+            // the announcement can not be reclaimed before the Reader is gone.
+            snapshot = channel.current.load();
+        }
+
+        ~Reader() {
+            channel.readers[reader].store(0);
+        }
+
+        /** The pinned snapshot, NULL if nothing has been published yet.
+        **/
+        const T* get() const {return snapshot;}
+        const T* operator->() const {return snapshot;}
+        const T& operator*() const {return *snapshot;}
+    };
+
+private:
+    std::atomic<const T*> current;
+    std::atomic<unsigned long> epoch;
+    std::atomic<unsigned long> readers[MAX_READERS];
+
+    /** Replaced snapshots, with the epoch at which they were replaced.
+    **/
+    std::vector<std::pair<const T*, unsigned long> > retired;
+
+    SnapshotChannel(const SnapshotChannel&);
+    SnapshotChannel& operator=(const SnapshotChannel&);
+
+    void reclaim() {
+        unsigned long oldest = 0;
+        for (int i = 0; i < MAX_READERS; ++i) {
+            unsigned long announced = readers[i].load();
+            if (announced != 0 && (oldest == 0 || announced < oldest))
+                oldest = announced;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); ++i) {
+            if (oldest == 0 || retired[i].second < oldest)
+                delete retired[i].first;
+            else
+                retired[kept++] = retired[i];
+        }
+        retired.resize(kept);
+    }
+
+public:
+    SnapshotChannel() : current(NULL), epoch(1) {
+        for (int i = 0; i < MAX_READERS; ++i) readers[i].store(0);
+    }
+
+    /** No Reader may be alive anymore.
+    **/
+    ~SnapshotChannel() {
+        for (size_t i = 0; i < retired.size(); ++i)
+            delete retired[i].first;
+        delete current.load();
+    }
+
+    /**
+      Publishes a new snapshot, and takes its ownership. Readers created
+      from now on see it. The snapshot must not be modified anymore.
+      */
+    void publish(const T* snapshot) {
+        const T* replaced = current.exchange(snapshot);
+        if (replaced) retired.push_back(std::make_pair(replaced, epoch.fetch_add(1)));
+        reclaim();
+    }
+
+    /**
+      The latest snapshot, to be used by writers only (which are serialised,
+      and are the only ones to reclaim snapshots).
+      */
+    const T* latest() const {
+        return current.load();
+    }
+};
+
+#endif // SNAPSHOT_H
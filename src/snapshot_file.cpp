@@ -0,0 +1,496 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include <boost/functional/hash.hpp>
+
+#include "oroview_exceptions.h"
+#include "constants.h"
+
+#include "snapshot_file.h"
+
+using namespace std;
+using boost::uint32_t;
+using boost::uint64_t;
+
+static const char SNAPSHOT_MAGIC[4] = {'O', 'R', 'G', 'S'};
+
+static uint64_t align(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+/** Slots of a hash table of 'count' entries: a power of two, at most 3/4
+  full.
+**/
+static uint32_t slotCount(size_t count) {
+    uint64_t slots = 1;
+    while (slots < count + count / 3 + 1) slots <<= 1;
+
+    if (slots > 0x80000000u)
+        throw OroViewException("Invalid graph snapshot: too many entries");
+
+    return slots;
+}
+
+static bool isPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Finalisers of MurmurHash3: the keys are hash values or indices, which do
+// not spread well enough over the low bits.
+static uint32_t mix(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+    return key;
+}
+
+static uint32_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (uint32_t) key;
+}
+
+SnapshotFile::SnapshotFile() :
+    data(NULL),
+    size(0)
+{
+}
+
+SnapshotFile::~SnapshotFile() {
+    close();
+}
+
+void SnapshotFile::close() {
+    if (data) munmap(const_cast<char*>(data), size);
+
+    data = NULL;
+    size = 0;
+}
+
+boost::shared_ptr<SnapshotFile> SnapshotFile::open(const string& path) {
+
+    boost::shared_ptr<SnapshotFile> file(new SnapshotFile());
+    if (!file->map(path)) return boost::shared_ptr<SnapshotFile>();
+
+    return file;
+}
+
+bool SnapshotFile::map(const string& path) {
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(Header)) {
+        void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            size = st.st_size;
+        }
+    }
+
+    ::close(fd);
+
+    if (!data || !check(path)) {
+        cerr << path << " is not a valid graph snapshot. Ignoring it." << endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotFile::check(const string& path) const {
+
+    const Header& h = header();
+
+    if (!equal(h.magic, h.magic + 4, SNAPSHOT_MAGIC) || h.version != VERSION) return false;
+
+    if (h.size != size) {
+        cerr << "Graph snapshot " << path << " is truncated." << endl;
+        return false;
+    }
+
+    if (!isPowerOfTwo(h.string_slots) || !isPowerOfTwo(h.id_slots) || !isPowerOfTwo(h.edge_slots))
+        return false;
+
+    // Every table lies within the file, in order
+    uint64_t sections[][2] = {
+        {h.strings_offset, ((uint64_t) h.strings + 1) * sizeof(uint32_t)},
+        {h.string_data_offset, h.string_bytes},
+        {h.string_slots_offset, (uint64_t) h.string_slots * sizeof(uint32_t)},
+        {h.nodes_offset, (uint64_t) h.nodes * sizeof(NodeRecord)},
+        {h.edges_offset, (uint64_t) h.edges * sizeof(LinkRecord)},
+        {h.relations_offset, (uint64_t) h.relations * sizeof(LinkRecord)},
+        {h.aliases_offset, (uint64_t) h.aliases * sizeof(AliasRecord)},
+        {h.positions_offset, (uint64_t) h.nodes * sizeof(PositionRecord)},
+        {h.id_slots_offset, (uint64_t) h.id_slots * sizeof(IdSlot)},
+        {h.edge_slots_offset, (uint64_t) h.edge_slots * sizeof(EdgeSlot)}
+    };
+
+    uint64_t end = sizeof(Header);
+
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+        if (sections[i][0] % 8 != 0 || sections[i][0] < end || sections[i][0] > size) return false;
+        end = sections[i][0] + sections[i][1];
+    }
+
+    if (end > size) return false;
+
+    // Every reference lies within its table
+    const uint32_t* offsets = table<uint32_t>(h.strings_offset);
+
+    if (offsets[0] != 0) return false;
+    for (uint32_t i = 0; i < h.strings; ++i) {
+        if (offsets[i + 1] < offsets[i] || offsets[i + 1] > h.string_bytes) return false;
+    }
+
+    const uint32_t* string_slots = table<uint32_t>(h.string_slots_offset);
+    for (uint32_t s = 0; s < h.string_slots; ++s) {
+        if (string_slots[s] > h.strings) return false;
+    }
+
+    // Every type is known (they are cast to the enums)
+    for (uint32_t i = 0; i < h.nodes; ++i) {
+        const NodeRecord& node = nodes()[i];
+        if (node.id >= h.strings || node.label >= h.strings || node.type > FALSE_NODE) return false;
+    }
+
+    const LinkRecord* tables[] = {edges(), relations()};
+    uint32_t counts[] = {h.edges, h.relations};
+
+    for (int t = 0; t < 2; ++t) {
+        for (uint32_t i = 0; i < counts[t]; ++i) {
+            const LinkRecord& link = tables[t][i];
+            if (link.from >= h.nodes || link.to >= h.nodes || link.label >= h.strings || link.type > UNDEFINED)
+                return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < h.aliases; ++i) {
+        if (aliases()[i].node >= h.nodes) return false;
+    }
+
+    for (uint32_t s = 0; s < h.id_slots; ++s) {
+        const IdSlot& slot = idSlots()[s];
+        if (slot.node != EMPTY && slot.node >= h.nodes) return false;
+    }
+
+    const EdgeSlot* edge_slots = table<EdgeSlot>(h.edge_slots_offset);
+    for (uint32_t s = 0; s < h.edge_slots; ++s) {
+        if (edge_slots[s].edge != EMPTY && edge_slots[s].edge >= h.edges) return false;
+    }
+
+    // Each node is found by the hash of its ID (its tag), and each alias by
+    // its key: the ID hash table holds nothing else.
+    uint32_t ids = 0;
+    for (uint32_t s = 0; s < h.id_slots; ++s) {
+        if (idSlots()[s].node != EMPTY) ids++;
+    }
+    if (ids != (uint64_t) h.nodes + h.aliases) return false;
+
+    for (uint32_t i = 0; i < h.nodes; ++i) {
+        const NodeRecord& node = nodes()[i];
+        const char* id = getString(node.id);
+
+        if (node.tag != (boost::int32_t) boost::hash_range(id, id + getStringLength(node.id)) || findId(node.tag) != i)
+            return false;
+    }
+
+    for (uint32_t i = 0; i < h.aliases; ++i) {
+        if (findId(aliases()[i].key) != aliases()[i].node) return false;
+    }
+
+    // Edges link two distinct nodes, and each pair of nodes at most once:
+    // the edge hash table gives back each edge from its nodes, and holds
+    // nothing else.
+    uint32_t edge_count = 0;
+    for (uint32_t s = 0; s < h.edge_slots; ++s) {
+        if (edge_slots[s].edge != EMPTY) edge_count++;
+    }
+    if (edge_count != h.edges) return false;
+
+    for (uint32_t e = 0; e < h.edges; ++e) {
+        const LinkRecord& edge = edges()[e];
+        if (edge.from == edge.to || findEdge(edge.from, edge.to) != e) return false;
+    }
+
+    // Relations go both ways (cf RelationTable::add): each relation between
+    // two distinct nodes has an edge, and a reverse relation along it.
+    enum {FORWARD = 1, BACKWARD = 2};
+    vector<char> directions(h.edges, 0);
+
+    // A relation and its reverse are usually saved one after the other:
+    // the edge of the previous relation is looked up first.
+    uint32_t edge = EMPTY;
+
+    for (uint32_t r = 0; r < h.relations; ++r) {
+        const LinkRecord& relation = relations()[r];
+        if (relation.from == relation.to) continue;
+
+        if (edge == EMPTY || edgeKey(edges()[edge].from, edges()[edge].to) != edgeKey(relation.from, relation.to))
+            edge = findEdge(relation.from, relation.to);
+        if (edge == EMPTY) return false;
+
+        directions[edge] |= edges()[edge].from == relation.from ? FORWARD : BACKWARD;
+    }
+
+    for (uint32_t e = 0; e < h.edges; ++e) {
+        if (directions[e] == FORWARD || directions[e] == BACKWARD) return false;
+    }
+
+    return true;
+}
+
+const SnapshotFile::Header& SnapshotFile::header() const {
+    return *table<Header>(0);
+}
+
+const char* SnapshotFile::getString(uint32_t index) const {
+    return data + header().string_data_offset + table<uint32_t>(header().strings_offset)[index];
+}
+
+size_t SnapshotFile::getStringLength(uint32_t index) const {
+    const uint32_t* offsets = table<uint32_t>(header().strings_offset);
+    return offsets[index + 1] - offsets[index];
+}
+
+StringTable SnapshotFile::strings() const {
+
+    StringTable strings;
+    strings.data = data + header().string_data_offset;
+    strings.offsets = table<uint32_t>(header().strings_offset);
+    strings.count = header().strings;
+    strings.slots = table<uint32_t>(header().string_slots_offset);
+    strings.mask = header().string_slots - 1;
+
+    return strings;
+}
+
+uint32_t SnapshotFile::findId(boost::int32_t key) const {
+
+    const IdSlot* slots = idSlots();
+    uint32_t mask = header().id_slots - 1;
+
+    for (uint32_t probe = 0, s = mix((uint32_t) key) & mask; probe <= mask; ++probe, s = (s + 1) & mask) {
+        if (slots[s].node == EMPTY) break;
+        if (slots[s].key == key) return slots[s].node;
+    }
+
+    return EMPTY;
+}
+
+uint64_t SnapshotFile::edgeKey(uint32_t node1, uint32_t node2) {
+    return node1 < node2 ? ((uint64_t) node1 << 32) | node2 : ((uint64_t) node2 << 32) | node1;
+}
+
+uint32_t SnapshotFile::findEdge(uint32_t node1, uint32_t node2) const {
+
+    const EdgeSlot* slots = table<EdgeSlot>(header().edge_slots_offset);
+    uint32_t mask = header().edge_slots - 1;
+    uint64_t key = edgeKey(node1, node2);
+
+    for (uint32_t probe = 0, s = mix(key) & mask; probe <= mask; ++probe, s = (s + 1) & mask) {
+        if (slots[s].edge == EMPTY) break;
+        if (slots[s].key == key) return slots[s].edge;
+    }
+
+    return EMPTY;
+}
+
+const SnapshotFile::IdSlot* SnapshotFile::idSlots() const {
+    return table<IdSlot>(header().id_slots_offset);
+}
+
+void SnapshotFile::buildRows(Rows rows, vector<uint32_t>& offsets,
+                             vector<AdjacencyIndex::Neighbour>& neighbours) const {
+
+    const Header& h = header();
+    const LinkRecord* links = rows == ADJACENCY ? edges() : relations();
+    uint32_t count = rows == ADJACENCY ? h.edges : h.relations;
+
+    // Size of each row, then offset of each row
+    offsets.assign(h.nodes + 1, 0);
+
+    for (uint32_t l = 0; l < count; ++l) {
+        if (rows != INCOMING) offsets[links[l].from + 1]++;
+        if (rows != OUTGOING) offsets[links[l].to + 1]++;
+    }
+
+    for (uint32_t i = 0; i < h.nodes; ++i)
+        offsets[i + 1] += offsets[i];
+
+    vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    neighbours.resize(offsets.back());
+
+    for (uint32_t l = 0; l < count; ++l) {
+        if (rows != INCOMING) {
+            AdjacencyIndex::Neighbour neighbour = {(int) links[l].to, (int) l};
+            neighbours[next[links[l].from]++] = neighbour;
+        }
+        if (rows != OUTGOING) {
+            AdjacencyIndex::Neighbour neighbour = {(int) links[l].from, (int) l};
+            neighbours[next[links[l].to]++] = neighbour;
+        }
+    }
+}
+
+const SnapshotFile::NodeRecord* SnapshotFile::nodes() const {
+    return table<NodeRecord>(header().nodes_offset);
+}
+
+const SnapshotFile::LinkRecord* SnapshotFile::edges() const {
+    return table<LinkRecord>(header().edges_offset);
+}
+
+const SnapshotFile::LinkRecord* SnapshotFile::relations() const {
+    return table<LinkRecord>(header().relations_offset);
+}
+
+const SnapshotFile::AliasRecord* SnapshotFile::aliases() const {
+    return table<AliasRecord>(header().aliases_offset);
+}
+
+const SnapshotFile::PositionRecord* SnapshotFile::positions() const {
+    return table<PositionRecord>(header().positions_offset);
+}
+
+template<typename T>
+static void writeTable(ostream& out, uint64_t offset, const vector<T>& records) {
+
+    while ((uint64_t) out.tellp() < offset) out.put('\0');
+
+    if (!records.empty())
+        out.write(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(T));
+}
+
+void SnapshotFile::save(const string& path, const Content& content) {
+
+    if (content.positions.size() != content.nodes.size())
+        throw OroViewException("Invalid graph snapshot: one position is needed per node");
+
+    vector<uint32_t> offsets;
+    offsets.reserve(content.strings.size() + 1);
+    offsets.push_back(0);
+
+    for (size_t i = 0; i < content.strings.size(); ++i)
+        offsets.push_back(offsets.back() + content.strings[i].str().size());
+
+    Header h;
+    copy(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4, h.magic);
+    h.version = VERSION;
+
+    h.strings = content.strings.size();
+    h.string_bytes = offsets.back();
+    h.nodes = content.nodes.size();
+    h.edges = content.edges.size();
+    h.relations = content.relations.size();
+    h.aliases = content.aliases.size();
+    h.string_slots = slotCount(content.strings.size());
+    h.id_slots = slotCount(content.ids.size());
+    h.edge_slots = slotCount(content.edges.size());
+    h.padding = 0;
+
+    // The hash tables
+    vector<uint32_t> string_slots(h.string_slots, 0);
+
+    for (size_t i = 0; i < content.strings.size(); ++i) {
+        const string& str = content.strings[i].str();
+        uint32_t s = StringPool::hashString(str.data(), str.size()) & (h.string_slots - 1);
+
+        while (string_slots[s] != 0) s = (s + 1) & (h.string_slots - 1);
+        string_slots[s] = i + 1;
+    }
+
+    IdSlot empty_id = {0, EMPTY};
+    vector<IdSlot> id_slots(h.id_slots, empty_id);
+
+    for (size_t i = 0; i < content.ids.size(); ++i) {
+        uint32_t s = mix((uint32_t) content.ids[i].key) & (h.id_slots - 1);
+
+        while (id_slots[s].node != EMPTY) s = (s + 1) & (h.id_slots - 1);
+        id_slots[s] = content.ids[i];
+    }
+
+    EdgeSlot empty_edge = {0, EMPTY, 0};
+    vector<EdgeSlot> edge_slots(h.edge_slots, empty_edge);
+
+    for (size_t e = 0; e < content.edges.size(); ++e) {
+        uint64_t key = edgeKey(content.edges[e].from, content.edges[e].to);
+        uint32_t s = mix(key) & (h.edge_slots - 1);
+
+        while (edge_slots[s].edge != EMPTY) s = (s + 1) & (h.edge_slots - 1);
+        edge_slots[s].key = key;
+        edge_slots[s].edge = e;
+    }
+
+    h.strings_offset = align(sizeof(Header));
+    h.string_data_offset = align(h.strings_offset + offsets.size() * sizeof(uint32_t));
+    h.string_slots_offset = align(h.string_data_offset + h.string_bytes);
+    h.nodes_offset = align(h.string_slots_offset + h.string_slots * sizeof(uint32_t));
+    h.edges_offset = align(h.nodes_offset + h.nodes * sizeof(NodeRecord));
+    h.relations_offset = align(h.edges_offset + h.edges * sizeof(LinkRecord));
+    h.aliases_offset = align(h.relations_offset + h.relations * sizeof(LinkRecord));
+    h.positions_offset = align(h.aliases_offset + h.aliases * sizeof(AliasRecord));
+    h.id_slots_offset = align(h.positions_offset + h.nodes * sizeof(PositionRecord));
+    h.edge_slots_offset = align(h.id_slots_offset + h.id_slots * sizeof(IdSlot));
+    h.size = h.edge_slots_offset + h.edge_slots * sizeof(EdgeSlot);
+
+    ofstream out(path.c_str(), ofstream::binary | ofstream::trunc);
+    if (!out)
+        throw OroViewException("Can not write the graph snapshot to " + path);
+
+    out.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+
+    writeTable(out, h.strings_offset, offsets);
+
+    while ((uint64_t) out.tellp() < h.string_data_offset) out.put('\0');
+    for (size_t i = 0; i < content.strings.size(); ++i) {
+        const string& str = content.strings[i].str();
+        out.write(str.data(), str.size());
+    }
+
+    writeTable(out, h.string_slots_offset, string_slots);
+    writeTable(out, h.nodes_offset, content.nodes);
+    writeTable(out, h.edges_offset, content.edges);
+    writeTable(out, h.relations_offset, content.relations);
+    writeTable(out, h.aliases_offset, content.aliases);
+    writeTable(out, h.positions_offset, content.positions);
+    writeTable(out, h.id_slots_offset, id_slots);
+    writeTable(out, h.edge_slots_offset, edge_slots);
+
+    if (!out)
+        throw OroViewException("Error while writing the graph snapshot to " + path);
+}
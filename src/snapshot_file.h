@@ -0,0 +1,238 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SNAPSHOT_FILE_H
+#define SNAPSHOT_FILE_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "string_pool.h"
+#include "adjacency.h"
+
+/**
+  Binary snapshot of a whole graph (cf Graph::saveSnapshot() and
+  Graph::loadSnapshot()). The file is mapped in memory: its tables are read
+  in place, without any parsing. Even the strings and the hash tables of
+  the graph are used in place (cf StringPool::addTable(), findId() and
+  findEdge()).
+
+  File format (native endianness, every table aligned on 8 bytes):
+   - header (cf Header): magic "ORGS", format version, size of each table
+     and offset of each table from the beginning of the file
+   - string table: offset of each string in the string data (one more
+     offset than strings, 32 bits integers), then the string data
+   - string hash table (cf StringTable): index + 1 of the strings, 0 for
+     empty slots
+   - node table (cf NodeRecord): ID, label, type and tag of each node
+   - edge table, then relation table (cf LinkRecord): origin, destination,
+     type and label of each edge and relation
+   - alias table (cf AliasRecord): node and key of each alias
+   - positions (cf PositionRecord): x and y of each node
+   - ID hash table (cf IdSlot): node of each ID (or alias) key
+   - edge hash table (cf EdgeSlot): edge between each pair of nodes
+
+  Strings are referred to by their index in the string table, nodes by
+  their index in the node table. Hash tables use open addressing, with
+  linear probing, and have a power of two amount of slots.
+  */
+class SnapshotFile
+{
+public:
+    static const boost::uint32_t VERSION = 2;
+
+    // Empty slot of the ID and edge hash tables
+    static const boost::uint32_t EMPTY = 0xFFFFFFFF;
+
+    /** The indices of the neighbours of the nodes (cf buildRows()).
+    **/
+    enum Rows {ADJACENCY, OUTGOING, INCOMING};
+
+    struct Header {
+        char magic[4];
+        boost::uint32_t version;
+
+        boost::uint32_t strings;
+        boost::uint32_t string_bytes;
+        boost::uint32_t nodes;
+        boost::uint32_t edges;
+        boost::uint32_t relations;
+        boost::uint32_t aliases;
+        boost::uint32_t string_slots;
+        boost::uint32_t id_slots;
+        boost::uint32_t edge_slots;
+        boost::uint32_t padding;
+
+        boost::uint64_t strings_offset;
+        boost::uint64_t string_data_offset;
+        boost::uint64_t string_slots_offset;
+        boost::uint64_t nodes_offset;
+        boost::uint64_t edges_offset;
+        boost::uint64_t relations_offset;
+        boost::uint64_t aliases_offset;
+        boost::uint64_t positions_offset;
+        boost::uint64_t id_slots_offset;
+        boost::uint64_t edge_slots_offset;
+        boost::uint64_t size;
+    };
+
+    /** The tag of a node is the hash value of its ID (cf NodeRenderer): it
+      is saved so that loading does not read the IDs.
+    **/
+    struct NodeRecord {
+        boost::uint32_t id;
+        boost::uint32_t label;
+        boost::uint32_t type;
+        boost::int32_t tag;
+    };
+
+    struct LinkRecord {
+        boost::uint32_t from;
+        boost::uint32_t to;
+        boost::uint32_t type;
+        boost::uint32_t label;
+    };
+
+    /** The key of an alias is the hash value of the alias (cf Graph::addAlias).
+    **/
+    struct AliasRecord {
+        boost::uint32_t node;
+        boost::int32_t key;
+    };
+
+    struct PositionRecord {
+        float x;
+        float y;
+    };
+
+    /** The key is the hash value of the ID, or of the alias, of the node
+      (cf Graph::ids).
+    **/
+    struct IdSlot {
+        boost::int32_t key;
+        boost::uint32_t node;
+    };
+
+    /** The key is made of the indices of the nodes, smallest first (cf
+      edgeKey()).
+    **/
+    struct EdgeSlot {
+        boost::uint64_t key;
+        boost::uint32_t edge;
+        boost::uint32_t padding;
+    };
+
+    /**
+      Tables to write (cf save()). The hash tables are built by save(): ids
+      lists the keys of the ID hash table, with their node.
+      */
+    struct Content {
+        std::vector<Symbol> strings;
+        std::vector<NodeRecord> nodes;
+        std::vector<LinkRecord> edges;
+        std::vector<LinkRecord> relations;
+        std::vector<AliasRecord> aliases;
+        std::vector<PositionRecord> positions;
+        std::vector<IdSlot> ids;
+    };
+
+    SnapshotFile();
+    ~SnapshotFile();
+
+    /**
+      Maps the file in memory and checks that it is a valid snapshot (every
+      table within the file, every reference within its table, every type
+      known, every node, alias and edge found by its hash table,
+      edges between two distinct nodes and at most one edge per pair of
+      nodes, relations in both directions). Returns false if the file does
+      not exist or is not valid.
+
+      The snapshot is shared: the string pool and the graph keep it mapped
+      for as long as they use its tables.
+      */
+    static boost::shared_ptr<SnapshotFile> open(const std::string& path);
+
+    void close();
+
+    const Header& header() const;
+
+    /** Characters of a string of the string table (not zero terminated).
+    **/
+    const char* getString(boost::uint32_t index) const;
+    size_t getStringLength(boost::uint32_t index) const;
+
+    /** The string table, and its hash table, for the string pool.
+    **/
+    StringTable strings() const;
+
+    /**
+      Node of an ID (or alias) key, or EMPTY if there is none.
+      */
+    boost::uint32_t findId(boost::int32_t key) const;
+
+    /**
+      Edge between two nodes (in any order), or EMPTY if there is none.
+      */
+    boost::uint32_t findEdge(boost::uint32_t node1, boost::uint32_t node2) const;
+
+    static boost::uint64_t edgeKey(boost::uint32_t node1, boost::uint32_t node2);
+
+    const IdSlot* idSlots() const;
+
+    /**
+      Rows of the adjacency of the edges, or of the outgoing or incoming
+      relations, for AdjacencyIndex::assign(): the neighbours of each node in
+      the order of the edges (or relations), as if they were added one by
+      one. Built with a counting sort rather than saved: it takes less time
+      than checking saved rows would.
+      */
+    void buildRows(Rows rows, std::vector<boost::uint32_t>& offsets,
+                   std::vector<AdjacencyIndex::Neighbour>& neighbours) const;
+
+    const NodeRecord* nodes() const;
+    const LinkRecord* edges() const;
+    const LinkRecord* relations() const;
+    const AliasRecord* aliases() const;
+    const PositionRecord* positions() const;
+
+    /**
+      Throws an OroViewException if the file can not be written.
+      */
+    static void save(const std::string& path, const Content& content);
+
+private:
+    const char* data;
+    size_t size;
+
+    bool map(const std::string& path);
+
+    SnapshotFile(const SnapshotFile&);
+    SnapshotFile& operator=(const SnapshotFile&);
+
+    template<typename T>
+    const T* table(boost::uint64_t offset) const {
+        return reinterpret_cast<const T*>(data + offset);
+    }
+
+    bool check(const std::string& path) const;
+};
+
+#endif // SNAPSHOT_FILE_H
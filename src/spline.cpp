@@ -18,6 +18,7 @@
 
 #include "constants.h"
 #include "macros.h"
+#include "memory_usage.h"
 
 #include "spline.h"
 #include "styles.h"
@@ -177,3 +178,7 @@ void SplineEdge::draw() {
 
     glEnd();
 }
+
+size_t SplineEdge::memoryUsage() const {
+    return capacityBytes(spline_point) + capacityBytes(spline_colour);
+}
@@ -45,6 +45,11 @@ public:
 
     void drawShadow();
     void draw();
+
+    /**
+      Bytes allocated for the points and colours of the spline.
+      */
+    size_t memoryUsage() const;
 };
 
 #endif
@@ -0,0 +1,391 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+#include <boost/bind/bind.hpp>
+
+#include "macros.h"
+#include "constants.h"
+#include "memory_usage.h"
+
+#include "stress_layout.h"
+
+using namespace std;
+using namespace boost::placeholders;
+
+// Iterations of the power method used by the pivot MDS
+static const int POWER_ITERATIONS = 100;
+
+/** Adds to a node the term pulling it at distance 'd' from the node at 'other'.
+**/
+static inline void addTerm(const vec2f& pos, const vec2f& other, float d, float w, bool before,
+                           vec2f& target, float& weights, double& stress, double& norm) {
+
+    vec2f delta = pos - other;
+    float len = delta.length();
+
+    // Coincident nodes are pulled apart along x, in opposite directions
+    if (len > 0.0)
+        target += (other + delta * (d / len)) * w;
+    else
+        target += (other + vec2f(before ? -d : d, 0.0)) * w;
+
+    weights += w;
+    // In double: once converged, the stress must not change with the rounding
+    double error = (double) len - d;
+    stress += w * error * error;
+    norm += (double) w * d * d;
+}
+
+StressLayout::StressLayout(WorkerPool& workers) :
+    workers(workers),
+    count(0),
+    pos(NULL),
+    last_stress(0.0)
+{
+}
+
+int StressLayout::nodesCount() const {
+    return count;
+}
+
+int StressLayout::pivotsCount() const {
+    return pivots.size();
+}
+
+size_t StressLayout::memoryUsage() const {
+    return capacityBytes(offsets) + capacityBytes(neighbours) + capacityBytes(pivots) +
+           capacityBytes(hops) + capacityBytes(pivot_weights) + capacityBytes(next_pos) +
+           capacityBytes(displacements) + capacityBytes(stress_terms) + capacityBytes(stress_norms);
+}
+
+double StressLayout::stress() const {
+    return last_stress;
+}
+
+void StressLayout::breadthFirst(int source, vector<int>& distances) const {
+
+    distances.assign(count, -1);
+
+    vector<int> queue;
+    queue.reserve(count);
+
+    distances[source] = 0;
+    queue.push_back(source);
+
+    for (size_t q = 0; q < queue.size(); ++q) {
+        int u = queue[q];
+
+        for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+            int v = neighbours[e];
+            if (distances[v] != -1) continue;
+
+            distances[v] = distances[u] + 1;
+            queue.push_back(v);
+        }
+    }
+}
+
+void StressLayout::setup(const AdjacencyIndex& adjacency, int max_pivots) {
+
+    count = adjacency.nodesCount();
+
+    offsets.assign(1, 0);
+    neighbours.clear();
+
+    for (int i = 0; i < count; ++i) {
+        for (AdjacencyIndex::const_iterator n = adjacency.begin(i); n != adjacency.end(i); ++n) {
+            if (n->node == i) continue;
+            neighbours.push_back(n->node);
+        }
+        offsets.push_back(neighbours.size());
+    }
+
+    pivots.clear();
+    int k = MIN(MAX(max_pivots, 0), count);
+
+    if (k == 0) {
+        hops.clear();
+        pivot_weights.clear();
+        return;
+    }
+
+    // Max-min selection of the pivots: the first one is the node with the
+    // highest degree, each next one is the node furthest from all the
+    // pivots so far. Nodes unreachable from every pivot come first: each
+    // connected component gets a pivot, as long as there are enough.
+    vector<vector<int> > distances(k);
+    vector<int> closest(count, INT_MAX);
+
+    int next = 0;
+    for (int i = 1; i < count; ++i) {
+        if (offsets[i + 1] - offsets[i] > offsets[next + 1] - offsets[next]) next = i;
+    }
+
+    while ((int) pivots.size() < k) {
+        int p = pivots.size();
+        pivots.push_back(next);
+        breadthFirst(next, distances[p]);
+
+        next = -1;
+        for (int i = 0; i < count; ++i) {
+            int d = distances[p][i];
+            if (d != -1) closest[i] = MIN(closest[i], d);
+
+            if (closest[i] > 0 && (next == -1 || closest[i] > closest[next])) next = i;
+        }
+
+        // Every node is a pivot
+        if (next == -1) break;
+    }
+
+    k = pivots.size();
+
+    hops.resize(count * k);
+    for (int i = 0; i < count; ++i) {
+        for (int p = 0; p < k; ++p) hops[i * k + p] = distances[p][i];
+    }
+
+    // Regions: each node belongs to its closest pivot. For each pivot,
+    // members[p][h] is the amount of nodes of its region at most h edges
+    // away from it.
+    vector<vector<int> > members(k);
+
+    for (int i = 0; i < count; ++i) {
+        int region = -1;
+        for (int p = 0; p < k; ++p) {
+            int d = hops[i * k + p];
+            if (d != -1 && (region == -1 || d < hops[i * k + region])) region = p;
+        }
+        if (region == -1) continue;
+
+        vector<int>& histogram = members[region];
+        int d = hops[i * k + region];
+        if ((int) histogram.size() <= d) histogram.resize(d + 1, 0);
+        histogram[d]++;
+    }
+
+    for (int p = 0; p < k; ++p) {
+        for (size_t h = 1; h < members[p].size(); ++h) members[p][h] += members[p][h - 1];
+    }
+
+    // The term between node i and pivot p stands for the nodes of p's region
+    // within half the distance from i to p.
+    pivot_weights.assign(count * k, 0.0);
+
+    for (int i = 0; i < count; ++i) {
+        for (int p = 0; p < k; ++p) {
+            int d = hops[i * k + p];
+            if (d <= 0) continue;
+
+            const vector<int>& histogram = members[p];
+            int h = MIN(d / 2, (int) histogram.size() - 1);
+            float represented = h >= 0 ? histogram[h] : 1;
+
+            float length = d * NOMINAL_EDGE_LENGTH;
+            pivot_weights[i * k + p] = represented / (length * length);
+        }
+    }
+
+    TRACE("Stress layout: " << count << " nodes, " << k << " pivots");
+}
+
+void StressLayout::initialise(vector<vec2f>& positions) const {
+
+    positions.resize(count);
+
+    int k = pivots.size();
+
+    // Not enough pivots for a meaningful MDS: a circle will do.
+    if (k < 3) {
+        float radius = NOMINAL_EDGE_LENGTH * sqrt((float) count);
+        for (int i = 0; i < count; ++i) {
+            float angle = 2 * M_PI * i / count;
+            positions[i] = vec2f(cos(angle), sin(angle)) * radius;
+        }
+        return;
+    }
+
+    // Squared distances to the pivots. Unreachable nodes are considered
+    // a bit further than the furthest reachable one.
+    int furthest = 0;
+    BOOST_FOREACH(int d, hops) furthest = MAX(furthest, d);
+
+    vector<double> squared(count * k);
+    for (size_t j = 0; j < hops.size(); ++j) {
+        double d = (hops[j] == -1 ? furthest + 1 : hops[j]) * NOMINAL_EDGE_LENGTH;
+        squared[j] = d * d;
+    }
+
+    // Double centering: C = -1/2 J D^2 J
+    vector<double> row_means(count, 0.0);
+    vector<double> column_means(k, 0.0);
+    double mean = 0.0;
+
+    for (int i = 0; i < count; ++i) {
+        for (int p = 0; p < k; ++p) {
+            double s = squared[i * k + p];
+            row_means[i] += s / k;
+            column_means[p] += s / count;
+            mean += s / (count * k);
+        }
+    }
+
+    vector<double>& c = squared;
+    for (int i = 0; i < count; ++i) {
+        for (int p = 0; p < k; ++p)
+            c[i * k + p] = -0.5 * (c[i * k + p] - row_means[i] - column_means[p] + mean);
+    }
+
+    // The two main eigenvectors of C^T C (k x k), by the power method
+    vector<double> ctc(k * k, 0.0);
+    for (int i = 0; i < count; ++i) {
+        const double* row = &c[i * k];
+        for (int p = 0; p < k; ++p) {
+            for (int q = 0; q < k; ++q) ctc[p * k + q] += row[p] * row[q];
+        }
+    }
+
+    vector<vector<double> > eigenvectors(2, vector<double>(k));
+    vector<double> product(k);
+
+    for (int e = 0; e < 2; ++e) {
+        vector<double>& v = eigenvectors[e];
+
+        // Arbitrary (but deterministic) start, not orthogonal to the solution
+        for (int p = 0; p < k; ++p) v[p] = 1.0 + (e == 0 ? p : k - p) % 7;
+
+        for (int it = 0; it < POWER_ITERATIONS; ++it) {
+
+            // The second eigenvector is kept orthogonal to the first one
+            if (e == 1) {
+                double dot = 0.0;
+                for (int p = 0; p < k; ++p) dot += v[p] * eigenvectors[0][p];
+                for (int p = 0; p < k; ++p) v[p] -= dot * eigenvectors[0][p];
+            }
+
+            double norm = 0.0;
+            for (int p = 0; p < k; ++p) {
+                product[p] = 0.0;
+                for (int q = 0; q < k; ++q) product[p] += ctc[p * k + q] * v[q];
+                norm += product[p] * product[p];
+            }
+
+            norm = sqrt(norm);
+            if (norm == 0.0) break;
+
+            for (int p = 0; p < k; ++p) v[p] = product[p] / norm;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        double x = 0.0, y = 0.0;
+        for (int p = 0; p < k; ++p) {
+            x += c[i * k + p] * eigenvectors[0][p];
+            y += c[i * k + p] * eigenvectors[1][p];
+        }
+        positions[i] = vec2f(x, y);
+    }
+
+    // Centring, and scaling to the nominal edge length
+    vec2f centre(0.0, 0.0);
+    for (int i = 0; i < count; ++i) centre += positions[i];
+    centre /= count;
+
+    float total_length = 0.0;
+    int edges = 0;
+    for (int i = 0; i < count; ++i) {
+        for (int e = offsets[i]; e < offsets[i + 1]; ++e) {
+            total_length += (positions[neighbours[e]] - positions[i]).length();
+            edges++;
+        }
+    }
+
+    float scale = total_length > 0.0 ? NOMINAL_EDGE_LENGTH * edges / total_length : 1.0;
+
+    for (int i = 0; i < count; ++i) positions[i] = (positions[i] - centre) * scale;
+}
+
+float StressLayout::iterate(vector<vec2f>& positions) {
+
+    if (count == 0 || (int) positions.size() != count) return 0.0;
+
+    pos = &positions;
+    next_pos.resize(count);
+    displacements.resize(count);
+    stress_terms.resize(count);
+    stress_norms.resize(count);
+
+    workers.parallelFor(count, boost::bind(&StressLayout::moveNodes, this, _1, _2));
+
+    positions.swap(next_pos);
+    pos = NULL;
+
+    float max_displacement = 0.0;
+    double stress = 0.0, norm = 0.0;
+
+    for (int i = 0; i < count; ++i) {
+        max_displacement = MAX(max_displacement, displacements[i]);
+        stress += stress_terms[i];
+        norm += stress_norms[i];
+    }
+
+    last_stress = norm > 0.0 ? stress / norm : 0.0;
+
+    return max_displacement;
+}
+
+void StressLayout::moveNodes(int begin, int end) {
+
+    const vector<vec2f>& current = *pos;
+    int k = pivots.size();
+
+    float neighbour_weight = 1.0 / (NOMINAL_EDGE_LENGTH * NOMINAL_EDGE_LENGTH);
+
+    for (int i = begin; i < end; ++i) {
+
+        vec2f target(0.0, 0.0);
+        float weights = 0.0;
+        double stress = 0.0, norm = 0.0;
+
+        for (int e = offsets[i]; e < offsets[i + 1]; ++e) {
+            int j = neighbours[e];
+            addTerm(current[i], current[j], NOMINAL_EDGE_LENGTH, neighbour_weight, i < j,
+                    target, weights, stress, norm);
+        }
+
+        for (int p = 0; p < k; ++p) {
+            float w = pivot_weights[i * k + p];
+            if (w == 0.0) continue;
+
+            int j = pivots[p];
+            addTerm(current[i], current[j], hops[i * k + p] * NOMINAL_EDGE_LENGTH, w, i < j,
+                    target, weights, stress, norm);
+        }
+
+        // Isolated nodes stay where they are
+        next_pos[i] = weights > 0.0 ? target / weights : current[i];
+
+        displacements[i] = (next_pos[i] - current[i]).length();
+        stress_terms[i] = stress;
+        stress_norms[i] = norm;
+    }
+}
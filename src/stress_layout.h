@@ -0,0 +1,118 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRESS_LAYOUT_H
+#define STRESS_LAYOUT_H
+
+#include <vector>
+
+#include "core/vectors.h"
+
+#include "adjacency.h"
+#include "worker_pool.h"
+
+/**
+  Sparse stress majorization layout (after Ortmann, Klimenta and Brandes,
+  "A Sparse Stress Model").
+
+  The ideal distance between two nodes is their graph-theoretic distance
+  (amount of edges on the shortest path) times NOMINAL_EDGE_LENGTH. Instead
+  of the O(N^2) terms of the full stress, each node only keeps the terms
+  with its neighbours, and with a small set of pivots spread over the graph
+  (max-min selection). The term with a pivot stands for all the nodes of the
+  pivot's region (the nodes closer to this pivot than to any other one)
+  that lie within half the distance to the pivot.
+
+  The initial placement comes from the pivot MDS of the distances to the
+  pivots. The layout is then improved by SMACOF iterations: every node
+  moves to the weighted average of the positions its terms call for. Each
+  iteration only reads the positions of the previous one, and is split
+  across the workers.
+
+  Unlike the spring-electrical model, the layout converges monotonically,
+  without oscillating, and deep hierarchies get stretched to their actual
+  depth.
+  */
+class StressLayout
+{
+public:
+    StressLayout(WorkerPool& workers);
+
+    /**
+      Computes the distances from the pivots to every node, and the weights
+      of the terms. To be called whenever the structure of the graph
+      changes. 'pivots' is the maximum amount of pivots.
+      */
+    void setup(const AdjacencyIndex& adjacency, int pivots);
+
+    /**
+      Places the nodes (by index) with the pivot MDS of the distances
+      computed by the last setup(). The layout is centred on (0, 0), and
+      scaled for edges to have, on average, their nominal length.
+      */
+    void initialise(std::vector<vec2f>& positions) const;
+
+    /**
+      Runs one SMACOF iteration on the positions (by index). Returns the
+      largest displacement of a node.
+      */
+    float iterate(std::vector<vec2f>& positions);
+
+    /**
+      Normalised stress of the positions the last iteration started from:
+      0 means every term has its ideal length.
+      */
+    double stress() const;
+
+    int nodesCount() const;
+    int pivotsCount() const;
+
+    size_t memoryUsage() const;
+
+private:
+    WorkerPool& workers;
+
+    int count;
+
+    // adjacency, in CSR format: neighbours of node i are in
+    // [offsets[i], offsets[i+1])
+    std::vector<int> offsets;
+    std::vector<int> neighbours;
+
+    std::vector<int> pivots;
+
+    // Distance (in edges) from pivot p to node i is hops[i * pivots + p],
+    // -1 if i can not be reached from p.
+    std::vector<int> hops;
+
+    // Weight of the term between node i and pivot p, same layout as hops.
+    std::vector<float> pivot_weights;
+
+    // Iteration state
+    const std::vector<vec2f>* pos;
+    std::vector<vec2f> next_pos;
+    std::vector<float> displacements;
+    std::vector<double> stress_terms;
+    std::vector<double> stress_norms;
+
+    double last_stress;
+
+    void breadthFirst(int source, std::vector<int>& distances) const;
+    void moveNodes(int begin, int end);
+};
+
+#endif // STRESS_LAYOUT_H
@@ -0,0 +1,441 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <unordered_set>
+#include <functional>
+#include <atomic>
+#include <cstring>
+#include <map>
+
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "oroview_exceptions.h"
+#include "memory_usage.h"
+
+#include "string_pool.h"
+
+using namespace std;
+
+// Strings are stored in chunks of CHUNK_SIZE strings, allocated on demand.
+static const uint32_t CHUNK_BITS = 12;
+static const uint32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+static const uint32_t MAX_CHUNKS = 4096;
+
+// Tables are referred to by a 16 bits index (cf Entry::table)
+static const size_t MAX_TABLES = 32767;
+
+static const uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+namespace {
+
+struct Entry {
+    string str;
+    // Collection during which the string was interned (cf StringPool::collect)
+    uint32_t epoch;
+    // False once released: the slot waits in the free list
+    bool used;
+    // Table of the string (cf StringPool::addTable), -1 if it belongs to the
+    // pool
+    int16_t table;
+    // False as long as the string of a table is not copied in 'str'
+    atomic<bool> ready;
+
+    Entry() : epoch(0), used(false), table(-1), ready(true) {}
+};
+
+struct Table {
+    StringTable strings;
+    // Symbol of the first string of the table
+    uint32_t first;
+    // Strings of the table still in the pool: the owner is released at 0
+    uint32_t live;
+    boost::shared_ptr<const void> owner;
+};
+
+const char* tableString(const StringTable& table, uint32_t i, size_t& length) {
+    length = table.offsets[i + 1] - table.offsets[i];
+    return table.data + table.offsets[i];
+}
+
+/** Index of the string in the table, NOT_FOUND if it is not in it.
+**/
+uint32_t findInTable(const StringTable& table, const char* str, size_t length, uint32_t hash) {
+
+    // Bounded, so that a full table does not loop forever
+    for (uint32_t probe = 0, s = hash & table.mask; probe <= table.mask; ++probe, s = (s + 1) & table.mask) {
+        if (table.slots[s] == 0) break;
+
+        uint32_t i = table.slots[s] - 1;
+        size_t candidate_length;
+        const char* candidate = tableString(table, i, candidate_length);
+
+        if (candidate_length == length && memcmp(candidate, str, length) == 0)
+            return i;
+    }
+
+    return NOT_FOUND;
+}
+
+struct Pool {
+    Entry* chunks[MAX_CHUNKS];
+    // Slots handed out so far, used or released
+    atomic<uint32_t> count;
+    vector<uint32_t> free_slots;
+
+    uint32_t epoch;
+    map<int, StringPool::Marker> holders;
+    int next_holder;
+
+    vector<Table> tables;
+
+    Entry& entry(uint32_t i) {
+        return chunks[i >> CHUNK_BITS][i & (CHUNK_SIZE - 1)];
+    }
+
+    const string& at(uint32_t i) const {
+        return chunks[i >> CHUNK_BITS][i & (CHUNK_SIZE - 1)].str;
+    }
+
+    // The index refers to the strings by their symbol: each string is only
+    // stored once, in its chunk.
+    struct Hash {
+        const Pool* pool;
+        Hash(const Pool* pool) : pool(pool) {}
+        size_t operator()(uint32_t i) const {return std::hash<string>()(pool->at(i));}
+    };
+
+    struct Equal {
+        const Pool* pool;
+        Equal(const Pool* pool) : pool(pool) {}
+        bool operator()(uint32_t a, uint32_t b) const {return pool->at(a) == pool->at(b);}
+    };
+
+    unordered_set<uint32_t, Hash, Equal> index;
+    boost::mutex mutex;
+
+    Pool() : count(0), epoch(0), next_holder(0), index(0, Hash(this), Equal(this)) {
+        for (uint32_t c = 0; c < MAX_CHUNKS; ++c) chunks[c] = NULL;
+
+        // Symbol 0 is the empty string
+        chunks[0] = new Entry[CHUNK_SIZE];
+        chunks[0][0].used = true;
+        index.insert(0);
+        count = 1;
+    }
+};
+
+// Built on first use: nodes may be created during static initialisation.
+Pool& pool() {
+    static Pool p;
+    return p;
+}
+
+}
+
+Symbol::Symbol(const std::string& str) :
+    index(StringPool::intern(str).index)
+{
+}
+
+const std::string& Symbol::str() const {
+    return StringPool::lookup(*this);
+}
+
+Symbol StringPool::intern(const string& str) {
+    return intern(str.data(), str.size());
+}
+
+Symbol StringPool::intern(const char* str, size_t length) {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    // The strings of the tables that are still in the pool
+    if (!p.tables.empty()) {
+        uint32_t hash = hashString(str, length);
+
+        for (size_t t = 0; t < p.tables.size(); ++t) {
+            const Table& table = p.tables[t];
+            if (table.live == 0) continue;
+
+            uint32_t j = findInTable(table.strings, str, length, hash);
+            if (j == NOT_FOUND) continue;
+
+            // Strings already in the pool when the table was added, or
+            // released since, are not used from the table.
+            const Entry& e = p.entry(table.first + j);
+            if (e.used && e.table == (int) t) return Symbol(table.first + j);
+        }
+    }
+
+    // Released slots are reused first
+    bool reused = !p.free_slots.empty();
+    uint32_t i = reused ? p.free_slots.back() : (uint32_t) p.count;
+
+    if ((i >> CHUNK_BITS) >= MAX_CHUNKS)
+        throw OroViewException("Too many distinct strings");
+
+    Entry*& chunk = p.chunks[i >> CHUNK_BITS];
+    if (chunk == NULL) chunk = new Entry[CHUNK_SIZE];
+
+    // The string is looked up from the next free slot: as long as it is not
+    // published, nobody else reads it.
+    Entry& e = chunk[i & (CHUNK_SIZE - 1)];
+    e.str.assign(str, length);
+    e.table = -1;
+    e.ready = true;
+
+    unordered_set<uint32_t, Pool::Hash, Pool::Equal>::const_iterator it = p.index.find(i);
+    if (it != p.index.end()) {
+        e.str.clear();
+        return Symbol(*it);
+    }
+
+    p.index.insert(i);
+
+    e.epoch = p.epoch;
+    e.used = true;
+
+    // Published once the string is in place
+    if (reused) p.free_slots.pop_back();
+    else p.count = i + 1;
+
+    return Symbol(i);
+}
+
+const string& StringPool::lookup(Symbol symbol) {
+
+    Pool& p = pool();
+    Entry& e = p.entry(symbol.raw());
+
+    if (e.ready.load(memory_order_acquire)) return e.str;
+
+    // First lookup of a string of a table: copied once, under the lock
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    if (!e.ready.load(memory_order_relaxed)) {
+        const Table& table = p.tables[e.table];
+
+        size_t length;
+        const char* str = tableString(table.strings, symbol.raw() - table.first, length);
+
+        e.str.assign(str, length);
+        e.ready.store(true, memory_order_release);
+    }
+
+    return e.str;
+}
+
+void StringPool::addTable(const StringTable& strings,
+                          const boost::shared_ptr<const void>& owner,
+                          vector<Symbol>& symbols) {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    if (p.tables.size() >= MAX_TABLES)
+        throw OroViewException("Too many string tables");
+
+    // The strings of the table take the next slots, in order
+    uint32_t first = p.count;
+
+    if (strings.count > (MAX_CHUNKS << CHUNK_BITS) - first)
+        throw OroViewException("Too many distinct strings");
+
+    symbols.resize(strings.count);
+    for (uint32_t j = 0; j < strings.count; ++j)
+        symbols[j] = Symbol(first + j);
+
+    // The strings already in the pool keep their symbol: the pool is looked
+    // up in the table (rather than each string of the table in the pool,
+    // usually much larger).
+    for (uint32_t i = 0; i < first; ++i) {
+        const Entry& e = p.entry(i);
+        if (!e.used) continue;
+
+        size_t length;
+        const char* str;
+
+        if (e.ready) {
+            str = e.str.data();
+            length = e.str.size();
+        }
+        else {
+            const Table& table = p.tables[e.table];
+            str = tableString(table.strings, i - table.first, length);
+        }
+
+        uint32_t j = findInTable(strings, str, length, hashString(str, length));
+        if (j != NOT_FOUND) symbols[j] = Symbol(i);
+    }
+
+    int16_t t = p.tables.size();
+    uint32_t live = 0;
+
+    for (uint32_t j = 0; j < strings.count; ++j) {
+        uint32_t i = first + j;
+
+        Entry*& chunk = p.chunks[i >> CHUNK_BITS];
+        if (chunk == NULL) chunk = new Entry[CHUNK_SIZE];
+
+        // Strings already in the pool leave their slot free
+        if (symbols[j].raw() != i) {
+            p.free_slots.push_back(i);
+            continue;
+        }
+
+        Entry& e = chunk[i & (CHUNK_SIZE - 1)];
+        e.table = t;
+        e.epoch = p.epoch;
+        e.used = true;
+        e.ready = false;
+
+        live++;
+    }
+
+    Table table;
+    table.strings = strings;
+    table.first = first;
+    table.live = live;
+    if (live > 0) table.owner = owner;
+
+    p.tables.push_back(table);
+
+    // Published once the entries are in place
+    p.count = first + strings.count;
+}
+
+uint32_t StringPool::hashString(const char* str, size_t length) {
+
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+int StringPool::size() {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    return p.count - p.free_slots.size();
+}
+
+int StringPool::addHolder(const Marker& marker) {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    p.holders[p.next_holder] = marker;
+    return p.next_holder++;
+}
+
+void StringPool::removeHolder(int key) {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    p.holders.erase(key);
+}
+
+int StringPool::collect() {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    vector<bool> marks(p.count, false);
+    marks[0] = true;
+
+    typedef pair<const int, Marker> Holder;
+    BOOST_FOREACH(const Holder& holder, p.holders) {
+        holder.second(marks);
+    }
+
+    int released = 0;
+
+    for (uint32_t i = 1; i < p.count; ++i) {
+        Entry& e = p.entry(i);
+
+        if (!e.used || marks[i] || e.epoch == p.epoch) continue;
+
+        // Looked up by its string: removed from the index before it is
+        // freed. The strings of a table are not in the index, and the table
+        // is released with its last string.
+        if (e.table < 0) p.index.erase(i);
+        else {
+            Table& table = p.tables[e.table];
+            if (--table.live == 0) table.owner.reset();
+            e.table = -1;
+        }
+
+        string().swap(e.str);
+        e.ready = true;
+        e.used = false;
+        p.free_slots.push_back(i);
+
+        released++;
+    }
+
+    p.epoch++;
+
+    return released;
+}
+
+size_t StringPool::memoryUsage() {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    size_t bytes = hashTableBytes(p.index) + capacityBytes(p.free_slots) + capacityBytes(p.tables);
+
+    for (uint32_t c = 0; c < MAX_CHUNKS && p.chunks[c] != NULL; ++c)
+        bytes += CHUNK_SIZE * sizeof(Entry);
+
+    for (uint32_t i = 0; i < p.count; ++i) {
+        const string& str = p.at(i);
+        const char* inline_begin = reinterpret_cast<const char*>(&str);
+
+        // Short strings are stored in the string object itself
+        if (str.data() < inline_begin || str.data() >= inline_begin + sizeof(string))
+            bytes += str.capacity() + 1;
+    }
+
+    return bytes;
+}
+
+void StringPool::reserve(int count) {
+
+    Pool& p = pool();
+
+    boost::lock_guard<boost::mutex> l(p.mutex);
+
+    p.index.reserve(p.index.size() + count);
+}
@@ -0,0 +1,172 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+/**
+  Compact (32 bits) reference to an interned string (cf StringPool). Two
+  symbols are equal if and only if their strings are equal.
+
+  The default symbol is the empty string.
+  */
+class Symbol
+{
+    uint32_t index;
+
+    friend class StringPool;
+    explicit Symbol(uint32_t index) : index(index) {}
+
+public:
+    Symbol() : index(0) {}
+
+    /**
+      Interns the string (cf StringPool::intern).
+      */
+    Symbol(const std::string& str);
+
+    const std::string& str() const;
+    bool empty() const {return index == 0;}
+
+    uint32_t raw() const {return index;}
+
+    bool operator==(const Symbol& other) const {return index == other.index;}
+    bool operator!=(const Symbol& other) const {return index != other.index;}
+
+    /** Arbitrary (but stable) order, not the order of the strings.
+    **/
+    bool operator<(const Symbol& other) const {return index < other.index;}
+};
+
+/**
+  Table of strings stored outside the pool, eg in a mapped graph snapshot
+  (cf StringPool::addTable()): 'count' strings, the characters of string i
+  being data[offsets[i]] to data[offsets[i + 1]] (not zero terminated).
+
+  Strings are looked up by their hash value (cf StringPool::hashString()) in
+  'slots', a hash table of mask + 1 slots (a power of two) with linear
+  probing: each slot holds the index of a string + 1, or 0 if it is empty.
+  */
+struct StringTable
+{
+    const char* data;
+    const uint32_t* offsets;
+    uint32_t count;
+    const uint32_t* slots;
+    uint32_t mask;
+};
+
+/**
+  Global table of interned strings: IDs and labels of the nodes, labels of
+  the relations and edges. Each distinct string is stored once, whatever the
+  amount of nodes or relations that refer to it.
+
+  Strings are released by collections (cf collect()): the holders of
+  symbols (the graphs) mark the symbols they still use, and the slots of the
+  other strings are reused by the next interned strings.
+
+  Strings can as well be referred to in place, in tables added with
+  addTable(): they are only copied in the pool the first time they are
+  looked up.
+
+  Interning takes a lock. Looking a symbol up does not (except the first
+  time for the strings of a table): strings are stored in chunks that are
+  never moved, and can be read from the rendering thread while other
+  strings are interned.
+  */
+class StringPool
+{
+public:
+    /**
+      Marks the symbols still used by a holder: sets marks[symbol.raw()] to
+      true for each of them.
+      */
+    typedef boost::function<void (std::vector<bool>& marks)> Marker;
+
+    /**
+      Returns the symbol of the string, adding the string to the pool if
+      needed.
+      */
+    static Symbol intern(const std::string& str);
+    static Symbol intern(const char* str, size_t length);
+
+    static const std::string& lookup(Symbol symbol);
+
+    /**
+      Adds the strings of a table to the pool, without copying them: fills
+      'symbols' with the symbol of each string of the table. The strings
+      already in the pool keep their symbol.
+
+      The owner keeps the table valid: it is released once none of the
+      strings of the table is used anymore (cf collect()).
+      */
+    static void addTable(const StringTable& table,
+                         const boost::shared_ptr<const void>& owner,
+                         std::vector<Symbol>& symbols);
+
+    /**
+      Hash value of a string used by the tables (FNV-1a): unlike std::hash,
+      it does not depend on the build.
+      */
+    static uint32_t hashString(const char* str, size_t length);
+
+    /**
+      Amount of distinct strings in the pool.
+      */
+    static int size();
+
+    /**
+      Registers a holder of symbols (eg a graph), and returns the key to
+      unregister it with removeHolder().
+      */
+    static int addHolder(const Marker& marker);
+    static void removeHolder(int key);
+
+    /**
+      Releases the strings that no holder marks anymore, eg once nodes have
+      been removed (cf Graph::enforceNodeBudget()). The pool never grows
+      larger than the most strings in use at once. Returns the amount of
+      released strings.
+
+      Strings interned since the previous collection are kept: they may be
+      used by code that does not hold them yet (say, a node being built by
+      another thread). The holders must not be modified during the
+      collection.
+      */
+    static int collect();
+
+    /**
+      Bytes allocated by the pool: the chunks, the characters of the
+      strings too long to be stored inline, and the index.
+      */
+    static size_t memoryUsage();
+
+    /**
+      Prepares the pool for 'count' more strings, eg before loading a graph.
+      */
+    static void reserve(int count);
+};
+
+#endif // STRING_POOL_H
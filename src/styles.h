@@ -35,6 +35,8 @@ static const int FOOTER_SPEED = 4; //how fast item names move on the bottom of t
 
 static const float FADE_TIME = 25.0; //idle time (in sec) before labels vanish
 static const float DECAY_TIME = 2.0; //idle time (in sec) before labels vanish
+static const float REDRAW_DELAY = 1.0; //time (in sec) the scene is still redrawn once nothing moves anymore
+static const float MAX_REDRAW_INTERVAL = 1.0; //the scene is redrawn at least once per period (in sec), even if nothing moves
 static const float SHADOW_STRENGTH = 0.5; //intensity of shadows (from 0.0 to 1.0)
 static const vec2f SHADOW_OFFSET(1.0, 1.0); //offset of shadows
 
@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include <boost/foreach.hpp>
+
+#include "macros.h"
+#include "constants.h"
+#include "memory_usage.h"
+
+#include "coulomb.h"
+#include "uniform_grid.h"
+
+using namespace std;
+
+// Upper bound on the amount of cells along each axis. For very sparse
+// layouts, cells get larger than the cutoff, instead of wasting memory.
+static const int MAX_GRID_DIMENSION = 1024;
+
+UniformGrid::UniformGrid() :
+    cell_size(1.0),
+    columns(1),
+    rows(1),
+    cutoff(DEFAULT_GRID_CUTOFF),
+    coulomb_constant(DEFAULT_COULOMB_CONSTANT)
+{
+}
+
+int UniformGrid::size() const {
+    return bodies.size();
+}
+
+size_t UniformGrid::memoryUsage() const {
+    return capacityBytes(inserted) + capacityBytes(bodies) + capacityBytes(cell_start);
+}
+
+void UniformGrid::reset(const vec2f& min, const vec2f& max, float cutoff, float coulomb_constant) {
+    inserted.clear();
+    bodies.clear();
+
+    this->cutoff = cutoff;
+    this->coulomb_constant = coulomb_constant;
+
+    // Small margin to make sure the nodes lying exactly on the bounds are inside.
+    origin = min - vec2f(1.0, 1.0);
+    vec2f extent = max - min + vec2f(2.0, 2.0);
+
+    cell_size = MAX(cutoff, MAX(extent.x, extent.y) / MAX_GRID_DIMENSION);
+
+    columns = (int) (extent.x / cell_size) + 1;
+    rows = (int) (extent.y / cell_size) + 1;
+}
+
+int UniformGrid::cellFor(const vec2f& pos) const {
+    int column = (int) ((pos.x - origin.x) / cell_size);
+    int row = (int) ((pos.y - origin.y) / cell_size);
+
+    return CLAMP(row, 0, rows - 1) * columns + CLAMP(column, 0, columns - 1);
+}
+
+void UniformGrid::insert(int index, const vec2f& pos, float charge) {
+    Body body;
+    body.index = index;
+    body.pos = pos;
+    body.charge = charge;
+    body.cell = cellFor(pos);
+
+    inserted.push_back(body);
+}
+
+void UniformGrid::computeCells() {
+
+    // Counting sort of the bodies by cell
+    cell_start.assign(columns * rows + 1, 0);
+
+    BOOST_FOREACH(const Body& body, inserted) {
+        cell_start[body.cell + 1]++;
+    }
+
+    for (int c = 0; c < columns * rows; ++c)
+        cell_start[c + 1] += cell_start[c];
+
+    vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+
+    bodies.resize(inserted.size());
+    BOOST_FOREACH(const Body& body, inserted) {
+        bodies[fill[body.cell]++] = body;
+    }
+}
+
+vec2f UniformGrid::repulsionAt(const vec2f& pos, float charge, int exclude) const {
+
+    vec2f force(0.0, 0.0);
+
+    if (bodies.empty()) return force;
+
+    int column = CLAMP((int) ((pos.x - origin.x) / cell_size), 0, columns - 1);
+    int row = CLAMP((int) ((pos.y - origin.y) / cell_size), 0, rows - 1);
+
+    float cutoff2 = cutoff * cutoff;
+
+    for (int r = MAX(row - 1, 0); r <= MIN(row + 1, rows - 1); ++r) {
+        for (int c = MAX(column - 1, 0); c <= MIN(column + 1, columns - 1); ++c) {
+
+            int cell = r * columns + c;
+
+            for (int b = cell_start[cell]; b < cell_start[cell + 1]; ++b) {
+                const Body& body = bodies[b];
+
+                if (body.index == exclude) continue;
+
+                vec2f delta = body.pos - pos;
+                if (delta.length2() > cutoff2) continue;
+
+                force += coulomb(delta, body.charge * charge);
+            }
+        }
+    }
+
+    return force * coulomb_constant;
+}
@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNIFORM_GRID_H
+#define UNIFORM_GRID_H
+
+#include <vector>
+
+#include "core/vectors.h"
+
+/**
+  Uniform grid (spatial hash) used to compute a short-range approximation of
+  the Coulomb repulsion: nodes further than a cutoff radius are ignored.
+
+  Cells are at least as large as the cutoff: the nodes within the cutoff of a
+  point always lie in the 3x3 cells around it. For evenly spread layouts,
+  the repulsion for one node is thus computed in O(1).
+
+  Like the Barnes-Hut tree, the grid is meant to be rebuilt from scratch at
+  each physics step: reset(), then insert() every node, then computeCells().
+  */
+class UniformGrid
+{
+    struct Body {
+        int index; // index of the node in the graph (cf Node::index)
+        vec2f pos;
+        float charge;
+        int cell;
+    };
+
+    // Bodies, as inserted, then sorted by cell
+    std::vector<Body> inserted;
+    std::vector<Body> bodies;
+
+    // Bodies of cell c are bodies[cell_start[c]] to bodies[cell_start[c+1] - 1]
+    std::vector<int> cell_start;
+
+    vec2f origin;
+    float cell_size;
+    int columns, rows;
+
+    float cutoff;
+    float coulomb_constant;
+
+    int cellFor(const vec2f& pos) const;
+
+public:
+    UniformGrid();
+
+    /**
+      Empties the grid and sets the area it covers, the cutoff radius and the
+      Coulomb constant of the repulsion. Nodes inserted afterwards must lie
+      within [min, max].
+      */
+    void reset(const vec2f& min, const vec2f& max, float cutoff, float coulomb_constant);
+
+    void insert(int index, const vec2f& pos, float charge);
+
+    /**
+      Sorts the inserted nodes by cell. Must be called once all nodes have
+      been inserted, and before any repulsion query.
+      */
+    void computeCells();
+
+    /**
+      Returns the Coulomb repulsion applied on a charge located at pos by the
+      nodes of the grid closer than the cutoff. If 'exclude' is a valid node
+      index, this node is not taken into account.
+      */
+    vec2f repulsionAt(const vec2f& pos, float charge, int exclude = -1) const;
+
+    int size() const;
+
+    size_t memoryUsage() const;
+};
+
+#endif // UNIFORM_GRID_H
@@ -0,0 +1,141 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "macros.h"
+
+#include "worker_pool.h"
+
+using namespace std;
+
+// Below this amount of items, the task is run in the calling thread only:
+// waking up the workers would cost more than the task itself.
+static const int MIN_PARALLEL_ITEMS = 64;
+
+// Each thread gets on average that many chunks, to balance the load when
+// items have uneven costs.
+static const int CHUNKS_PER_THREAD = 8;
+static const int MIN_CHUNK_SIZE = 16;
+
+WorkerPool::WorkerPool() :
+    task_size(0),
+    chunk_size(MIN_CHUNK_SIZE),
+    generation(0),
+    busy_workers(0),
+    quit(false),
+    next_item(0)
+{
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+int WorkerPool::threadsCount() const {
+    return threads.size() + 1;
+}
+
+void WorkerPool::setThreadsCount(int count) {
+
+    if (count <= 0) count = boost::thread::hardware_concurrency();
+    if (count < 1) count = 1;
+
+    if (count == threadsCount()) return;
+
+    stop();
+
+    quit = false;
+
+    for (int i = 1; i < count; ++i)
+        threads.push_back(new boost::thread(&WorkerPool::work, this, generation));
+
+    TRACE("Physics now running on " << count << " threads");
+}
+
+void WorkerPool::stop() {
+
+    {
+        boost::lock_guard<boost::mutex> l(mutex);
+        quit = true;
+    }
+    wake_cond.notify_all();
+
+    BOOST_FOREACH(boost::thread* t, threads) {
+        t->join();
+        delete t;
+    }
+
+    threads.clear();
+}
+
+void WorkerPool::parallelFor(int count, const Task& task) {
+
+    if (count <= 0) return;
+
+    if (threads.empty() || count < MIN_PARALLEL_ITEMS) {
+        task(0, count);
+        return;
+    }
+
+    {
+        boost::lock_guard<boost::mutex> l(mutex);
+
+        this->task = task;
+        task_size = count;
+        chunk_size = MAX(MIN_CHUNK_SIZE, count / (threadsCount() * CHUNKS_PER_THREAD));
+        next_item = 0;
+        busy_workers = threads.size();
+        ++generation;
+    }
+    wake_cond.notify_all();
+
+    runChunks();
+
+    boost::unique_lock<boost::mutex> l(mutex);
+    while (busy_workers > 0) done_cond.wait(l);
+}
+
+void WorkerPool::runChunks() {
+    while (true) {
+        int begin = next_item.fetch_add(chunk_size);
+        if (begin >= task_size) return;
+
+        task(begin, MIN(begin + chunk_size, task_size));
+    }
+}
+
+void WorkerPool::work(int seen_generation) {
+
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> l(mutex);
+            while (!quit && generation == seen_generation) wake_cond.wait(l);
+
+            if (quit) return;
+            seen_generation = generation;
+        }
+
+        runChunks();
+
+        {
+            boost::lock_guard<boost::mutex> l(mutex);
+            if (--busy_workers == 0) done_cond.notify_one();
+        }
+    }
+}
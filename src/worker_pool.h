@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2010 Séverin Lemaignan (slemaign@laas.fr)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version
+    3 of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <atomic>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+  A fixed pool of threads, used to split loops over nodes or edges.
+
+  The thread calling parallelFor() takes its share of the work: a pool of N
+  threads runs N-1 background threads.
+  */
+class WorkerPool
+{
+public:
+    /**
+      A task processes the items in [begin, end).
+      */
+    typedef boost::function<void (int begin, int end)> Task;
+
+    WorkerPool();
+    ~WorkerPool();
+
+    /**
+      Sets the amount of threads used to run tasks (including the calling
+      thread). 0 means one thread per available core.
+      */
+    void setThreadsCount(int count);
+    int threadsCount() const;
+
+    /**
+      Splits [0, count) in chunks and runs 'task' on every chunk, in
+      parallel. Blocks until all the chunks have been processed.
+
+      Chunks are distributed dynamically to the threads: the task must not
+      depend on which thread processes which chunk.
+      */
+    void parallelFor(int count, const Task& task);
+
+private:
+    std::vector<boost::thread*> threads;
+
+    boost::mutex mutex;
+    boost::condition_variable wake_cond;
+    boost::condition_variable done_cond;
+
+    // Current job. Only modified while holding 'mutex'.
+    Task task;
+    int task_size;
+    int chunk_size;
+    int generation;
+    int busy_workers;
+    bool quit;
+
+    std::atomic<int> next_item;
+
+    void stop();
+    void work(int generation);
+    void runChunks();
+};
+
+#endif // WORKER_POOL_H
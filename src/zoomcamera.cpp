@@ -136,3 +136,8 @@ void ZoomCamera::logic(float dt) {
 
     target = vec3f(pos.x, pos.y, 0.0);
 }
+
+//true until the camera has (almost) reached its destination
+bool ZoomCamera::isMoving() const {
+    return (dest - pos).length2() > 0.01;
+}
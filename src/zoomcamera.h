@@ -46,6 +46,7 @@ public:
 
     void reset();
     void logic(float dt);
+    bool isMoving() const;
     void adjust(Bounds2D& bounds);
 };
 